@@ -0,0 +1,595 @@
+#include "bvh.h"
+#include "command_buffer.h"
+#include "frame_stats.h"
+#include "frustum_cull.h"
+#include "instancing.h"
+#include "job_system.h"
+#include "mesh_import.h"
+#include "render_queue.h"
+#include "soft_raster.h"
+#include "vertex_format.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Standalone CPU benchmarks, each printing one JSON object per configuration
+// Usage: hello_triangle_bench [--list] [--iterations N] [--threads N] [name...]
+// ---------------------------------------------------------------------------
+
+struct BenchOptions
+{
+	unsigned int iterations = 20;
+	// Largest thread count tried by benchmarks that scale over cores, 0 uses every hardware thread
+	unsigned int threads = 0;
+};
+
+// Times fn over options.iterations runs after one warm-up run
+template <typename Fn>
+static std::vector<double> timeRuns(const BenchOptions &options, Fn fn)
+{
+	fn();
+	std::vector<double> samples;
+	samples.reserve(options.iterations);
+	for (unsigned int i = 0; i < options.iterations; i++)
+	{
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		fn();
+		samples.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+	}
+	return samples;
+}
+
+// Prints {"benchmark": name, <params>, "ms": {...}}, params is a pre-formatted list of JSON members
+static void report(const char *name, const std::string &params, const std::vector<double> &samples)
+{
+	TimingSummary summary = summarizeTimings(samples);
+	std::cout << "{ \"benchmark\": \"" << name << "\", " << params
+		<< ", \"ms\": { \"min\": " << summary.min << ", \"median\": " << summary.median
+		<< ", \"p99\": " << summary.p99 << ", \"max\": " << summary.max << " } }" << std::endl;
+}
+
+static std::vector<unsigned int> threadCounts(const BenchOptions &options)
+{
+	unsigned int maxThreads = options.threads ? options.threads : std::max(1u, std::thread::hardware_concurrency());
+	std::vector<unsigned int> counts;
+	for (unsigned int threads = 1; threads < maxThreads; threads *= 2)
+		counts.push_back(threads);
+	counts.push_back(maxThreads);
+	return counts;
+}
+
+// Software rasterizer
+// -------------------
+// Unit quad, same as vertices[]/indices[] in main.cpp
+static const float QUAD_VERTICES[] = {
+	0.5f,  0.5f, 0.0f,
+	0.5f, -0.5f, 0.0f,
+	-0.5f, -0.5f, 0.0f,
+	-0.5f,  0.5f, 0.0f
+};
+static const unsigned int QUAD_INDICES[] = {
+	0, 2, 3,
+	0, 1, 2
+};
+
+static void benchSoftRaster(const BenchOptions &options)
+{
+	const unsigned int instanceCounts[] = { 1, 10000, 100000 };
+	const float clearColor[4] = { 0.2f, 0.3f, 0.3f, 1.0f };
+	std::vector<unsigned int> threads = threadCounts(options);
+
+	for (size_t i = 0; i < sizeof(instanceCounts) / sizeof(instanceCounts[0]); i++)
+	{
+		std::vector<InstanceData> instances;
+		generateInstanceGrid(instanceCounts[i], instances);
+		for (size_t t = 0; t < threads.size(); t++)
+		{
+			SoftRasterizer rasterizer;
+			rasterizer.init(800, 600, threads[t]);
+			std::vector<double> samples = timeRuns(options, [&]() {
+				rasterizer.clear(clearColor);
+				rasterizer.drawElementsInstanced(QUAD_VERTICES, 4, QUAD_INDICES, 6, instances.data(), (unsigned int)instances.size());
+			});
+			report("soft_raster", "\"simd\": \"" + std::string(SoftRasterizer::simdPath()) + "\", \"instances\": "
+				+ std::to_string(instanceCounts[i]) + ", \"threads\": " + std::to_string(threads[t]), samples);
+		}
+	}
+}
+
+// Render queue
+// ------------
+// Items spread over 64 programs, 256 VAOs and 1024 textures in random order, which is the worst
+// case for submission order; reports the state switches left after sorting and the CPU cost of
+// building and sorting the queue for one frame
+static void benchRenderQueue(const BenchOptions &options)
+{
+	const unsigned int itemCounts[] = { 10000, 100000 };
+	for (size_t i = 0; i < sizeof(itemCounts) / sizeof(itemCounts[0]); i++)
+	{
+		std::vector<DrawItem> items(itemCounts[i]);
+		std::mt19937 random(1234);
+		for (size_t item = 0; item < items.size(); item++)
+		{
+			items[item].program = 1 + random() % 64;
+			items[item].vertexArray = 1 + random() % 256;
+			items[item].texture = 1 + random() % 1024;
+			items[item].indexCount = 6;
+			items[item].depth = (float)(random() % 65536) / 65535.0f;
+		}
+
+		for (int sorted = 0; sorted < 2; sorted++)
+		{
+			RenderQueue queue;
+			queue.setSorting(sorted != 0);
+			queue.reserve(items.size());
+			std::vector<double> samples = timeRuns(options, [&]() {
+				queue.clear();
+				for (size_t item = 0; item < items.size(); item++)
+					queue.push(items[item]);
+				queue.sort();
+			});
+			RenderQueueStats stats = queue.countStateChanges();
+			report("render_queue", "\"items\": " + std::to_string(itemCounts[i]) + ", \"sorted\": " + (sorted ? "true" : "false")
+				+ ", \"program_changes\": " + std::to_string(stats.programChanges)
+				+ ", \"vao_changes\": " + std::to_string(stats.vertexArrayChanges)
+				+ ", \"texture_changes\": " + std::to_string(stats.textureChanges), samples);
+		}
+	}
+}
+
+// Command recording
+// -----------------
+// Records a sorted queue of 100k items into per-thread command buffers, as --parallel-record does;
+// execution on the GL thread is not included
+static void benchCommandRecord(const BenchOptions &options)
+{
+	const unsigned int itemCount = 100000;
+	std::vector<InstanceData> grid;
+	generateInstanceGrid(itemCount, grid);
+	RenderQueue queue;
+	for (unsigned int i = 0; i < itemCount; i++)
+	{
+		DrawItem item;
+		item.program = 1 + i % 2;
+		item.vertexArray = 1;
+		item.indexCount = 6;
+		item.instance = grid[i];
+		queue.push(item);
+	}
+	queue.sort();
+
+	std::vector<unsigned int> threads = threadCounts(options);
+	for (size_t t = 0; t < threads.size(); t++)
+	{
+		JobSystem jobs;
+		jobs.init(threads[t]);
+		ParallelRecorder recorder;
+		recorder.init(jobs);
+		std::vector<double> samples = timeRuns(options, [&]() {
+			recorder.record([&](unsigned int worker, CommandBuffer &buffer) {
+				size_t workers = recorder.getThreadCount();
+				queue.record(buffer, queue.size() * worker / workers, queue.size() * (worker + 1) / workers);
+			});
+		});
+		report("command_record", "\"items\": " + std::to_string(itemCount) + ", \"threads\": " + std::to_string(threads[t])
+			+ ", \"commands\": " + std::to_string(recorder.getCommandCount())
+			+ ", \"bytes\": " + std::to_string(recorder.getBytesUsed()), samples);
+	}
+}
+
+// Job system
+// ----------
+// Animating and culling 1M grid instances, serially and with parallelFor, plus the cost of a
+// few thousand empty child jobs under one parent (scheduling overhead only)
+static void benchJobSystem(const BenchOptions &options)
+{
+	const unsigned int instanceCount = 1000000;
+	// Stays below the job ring size, every child is alive until the parent is waited on
+	const unsigned int emptyJobs = JobSystem::MAX_JOBS_PER_WORKER - 1;
+	std::vector<InstanceData> grid;
+	generateInstanceGrid(instanceCount, grid);
+	std::vector<InstanceData> animated(instanceCount);
+	std::vector<unsigned char> visible(instanceCount);
+	auto animateRange = [&](size_t first, size_t last) {
+		for (size_t i = first; i < last; i++)
+		{
+			animateInstance(grid[i], 1.0f, animated[i]);
+			visible[i] = isInstanceVisible(animated[i]);
+		}
+	};
+
+	report("job_system", "\"mode\": \"serial\", \"instances\": " + std::to_string(instanceCount) + ", \"threads\": 1",
+		timeRuns(options, [&]() { animateRange(0, instanceCount); }));
+
+	std::vector<unsigned int> threads = threadCounts(options);
+	for (size_t t = 0; t < threads.size(); t++)
+	{
+		JobSystem jobs;
+		jobs.init(threads[t]);
+		report("job_system", "\"mode\": \"parallel_for\", \"instances\": " + std::to_string(instanceCount)
+			+ ", \"threads\": " + std::to_string(threads[t]),
+			timeRuns(options, [&]() { jobs.parallelFor(instanceCount, 4096, animateRange); }));
+
+		std::atomic<unsigned int> executed(0);
+		std::vector<double> samples = timeRuns(options, [&]() {
+			JobSystem::Job *root = jobs.create([]() {});
+			for (unsigned int i = 0; i < emptyJobs; i++)
+				jobs.run(jobs.create([&executed]() { executed++; }, root));
+			jobs.run(root);
+			jobs.wait(root);
+		});
+		report("job_system", "\"mode\": \"empty_jobs\", \"jobs\": " + std::to_string(emptyJobs)
+			+ ", \"threads\": " + std::to_string(threads[t]), samples);
+	}
+}
+
+// Mesh import
+// -----------
+// A 700x700 vertex grid with jittered positions, as OBJ text and as binary PLY, imported from memory
+// (parse, triangulate, merge duplicates); the right column's vertices are written twice like the seams
+// of a scanned mesh, so deduplication has something to merge
+static void benchMeshImport(const BenchOptions &options)
+{
+	const unsigned int side = 700;
+	std::mt19937 random(42);
+	std::uniform_real_distribution<float> jitter(-0.001f, 0.001f);
+	// Rows of side + 1 vertices, the last one a copy of the one before
+	std::vector<float> positions;
+	for (unsigned int y = 0; y < side; y++)
+	{
+		for (unsigned int x = 0; x < side; x++)
+		{
+			positions.push_back(x / (float)side + jitter(random));
+			positions.push_back(y / (float)side + jitter(random));
+			positions.push_back(jitter(random));
+		}
+		positions.insert(positions.end(), positions.end() - 3, positions.end());
+	}
+	std::vector<unsigned int> quads;
+	for (unsigned int y = 0; y + 1 < side; y++)
+		for (unsigned int x = 0; x + 1 < side; x++)
+		{
+			// The last quad of a row uses the seam copies
+			unsigned int right = x + 2 == side ? side : x + 1;
+			quads.push_back(y * (side + 1) + x);
+			quads.push_back(y * (side + 1) + right);
+			quads.push_back((y + 1) * (side + 1) + right);
+			quads.push_back((y + 1) * (side + 1) + x);
+		}
+
+	std::string obj;
+	char line[128];
+	for (size_t v = 0; v < positions.size(); v += 3)
+		obj.append(line, std::snprintf(line, sizeof(line), "v %.6f %.6f %.6f\n", positions[v], positions[v + 1], positions[v + 2]));
+	for (size_t q = 0; q < quads.size(); q += 4)
+		obj.append(line, std::snprintf(line, sizeof(line), "f %u/%u %u/%u %u/%u %u/%u\n", quads[q] + 1, quads[q] + 1,
+			quads[q + 1] + 1, quads[q + 1] + 1, quads[q + 2] + 1, quads[q + 2] + 1, quads[q + 3] + 1, quads[q + 3] + 1));
+
+	std::string ply = "ply\nformat binary_little_endian 1.0\nelement vertex " + std::to_string(positions.size() / 3)
+		+ "\nproperty float x\nproperty float y\nproperty float z\nelement face " + std::to_string(quads.size() / 4)
+		+ "\nproperty list uchar int vertex_indices\nend_header\n";
+	ply.append((const char *)positions.data(), positions.size() * sizeof(float));
+	for (size_t q = 0; q < quads.size(); q += 4)
+	{
+		ply.push_back((char)4);
+		ply.append((const char *)&quads[q], 4 * sizeof(unsigned int));
+	}
+
+	std::vector<unsigned int> threads = threadCounts(options);
+	for (int format = 0; format < 2; format++)
+	{
+		const std::string &text = format ? ply : obj;
+		for (size_t t = 0; t < threads.size(); t++)
+		{
+			JobSystem jobs;
+			jobs.init(threads[t]);
+			ImportedMesh mesh;
+			std::vector<double> samples = timeRuns(options, [&]() {
+				importMeshFromMemory(text.data(), text.size(), format != 0, &jobs, mesh);
+			});
+			double medianMs = summarizeTimings(samples).median;
+			report("mesh_import", std::string("\"format\": \"") + (format ? "ply_binary" : "obj") + "\", \"threads\": " + std::to_string(threads[t])
+				+ ", \"bytes\": " + std::to_string(text.size()) + ", \"vertices\": " + std::to_string(mesh.getVertexCount())
+				+ ", \"merged\": " + std::to_string(mesh.sourceVertices - mesh.getVertexCount())
+				+ ", \"triangles\": " + std::to_string(mesh.getIndexCount() / 3)
+				+ ", \"mb_per_s\": " + std::to_string(medianMs > 0.0 ? text.size() / (medianMs * 1000.0) : 0.0), samples);
+		}
+	}
+}
+
+// Vertex quantization
+// -------------------
+// Decodes a vertex the way the vertex shader does, unnormalized integers times scale plus offset
+static void dequantizePosition(MeshVertexFormat format, const PositionQuantization &quantization,
+	const unsigned char *vertex, float position[3])
+{
+	for (int axis = 0; axis < 3; axis++)
+	{
+		float value;
+		if (format == MESH_VERTEX_POSITION_U16)
+		{
+			unsigned short packed[4];
+			std::memcpy(packed, vertex, sizeof(packed));
+			value = packed[axis];
+		}
+		else if (format == MESH_VERTEX_POSITION_I10)
+		{
+			unsigned int packed;
+			std::memcpy(&packed, vertex, sizeof(packed));
+			int bits = (int)((packed >> (axis * 10)) & 0x3FF);
+			value = (float)(bits >= 512 ? bits - 1024 : bits);
+		}
+		else
+			std::memcpy(&value, vertex + axis * sizeof(float), sizeof(float));
+		position[axis] = value * quantization.scale[axis] + quantization.offset[axis];
+	}
+}
+
+static void benchVertexQuantize(const BenchOptions &options)
+{
+	// 1M random positions in a 10 unit cube, the error scales with the extent of the bounds
+	const unsigned int vertexCount = 1 << 20;
+	std::mt19937 random(7);
+	std::uniform_real_distribution<float> coordinate(-5.0f, 5.0f);
+	std::vector<float> positions(vertexCount * 3);
+	for (size_t i = 0; i < positions.size(); i++)
+		positions[i] = coordinate(random);
+	float boundsMin[3], boundsMax[3];
+	computeBounds(positions.data(), vertexCount, boundsMin, boundsMax);
+
+	const MeshVertexFormat formats[] = { MESH_VERTEX_POSITION_F32, MESH_VERTEX_POSITION_U16, MESH_VERTEX_POSITION_I10 };
+	for (size_t f = 0; f < sizeof(formats) / sizeof(formats[0]); f++)
+	{
+		PositionQuantization quantization = computeQuantization(formats[f], boundsMin, boundsMax);
+		std::vector<unsigned char> encoded;
+		std::vector<double> samples = timeRuns(options, [&]() {
+			quantizePositions(formats[f], quantization, positions.data(), vertexCount, encoded);
+		});
+		unsigned int stride = getVertexStride(formats[f]);
+		float maxError = 0.0f;
+		for (unsigned int i = 0; i < vertexCount; i++)
+		{
+			float decoded[3];
+			dequantizePosition(formats[f], quantization, &encoded[(size_t)i * stride], decoded);
+			for (int axis = 0; axis < 3; axis++)
+				maxError = std::max(maxError, std::fabs(decoded[axis] - positions[i * 3 + axis]));
+		}
+		report("vertex_quantize", std::string("\"format\": \"") + getVertexFormatName(formats[f]) + "\", \"vertices\": "
+			+ std::to_string(vertexCount) + ", \"bytes_per_vertex\": " + std::to_string(stride)
+			+ ", \"bytes\": " + std::to_string(encoded.size()) + ", \"max_error\": " + std::to_string(maxError), samples);
+	}
+}
+
+// Frustum culling
+// ---------------
+// Perspective camera at the origin looking down -z: 60 degree vertical field of view, 16:9, 0.1 to 100
+static void makeBenchFrustum(Frustum &frustum)
+{
+	const float fieldOfView = 1.0471976f, aspect = 16.0f / 9.0f, zNear = 0.1f, zFar = 100.0f;
+	float focal = 1.0f / std::tan(fieldOfView * 0.5f);
+	const float projection[16] = {
+		focal / aspect, 0.0f, 0.0f, 0.0f,
+		0.0f, focal, 0.0f, 0.0f,
+		0.0f, 0.0f, (zFar + zNear) / (zNear - zFar), -1.0f,
+		0.0f, 0.0f, 2.0f * zFar * zNear / (zNear - zFar), 0.0f
+	};
+	extractFrustum(projection, frustum);
+}
+
+// Both culls must keep the same objects, reports the first difference otherwise
+static bool checkSameVisible(const char *what, const std::vector<unsigned int> &expected, size_t expectedCount,
+	const std::vector<unsigned int> &actual, size_t actualCount)
+{
+	size_t common = std::min(expectedCount, actualCount);
+	size_t i = std::mismatch(expected.begin(), expected.begin() + common, actual.begin()).first - expected.begin();
+	if (i == common && expectedCount == actualCount)
+		return true;
+	std::cout << "ERROR::BENCH::" << what << "_MISMATCH at " << i << " of " << expectedCount << " vs " << actualCount << std::endl;
+	return false;
+}
+
+// 1M random boxes around the bench camera, roughly a third of them visible; the scalar reference against the SIMD path
+static void benchFrustumCull(const BenchOptions &options)
+{
+	const unsigned int objectCount = 1000000;
+	Frustum frustum;
+	makeBenchFrustum(frustum);
+
+	std::mt19937 random(11);
+	std::uniform_real_distribution<float> side(-60.0f, 60.0f);
+	std::uniform_real_distribution<float> depth(-120.0f, 10.0f);
+	std::uniform_real_distribution<float> size(0.1f, 3.0f);
+	CullBounds bounds;
+	bounds.resize(objectCount);
+	for (unsigned int i = 0; i < objectCount; i++)
+	{
+		float center[3] = { side(random), side(random), depth(random) };
+		float extent[3] = { size(random), size(random), size(random) };
+		bounds.setBox(i, center, extent);
+	}
+
+	std::vector<unsigned int> visible(objectCount + CULL_BATCH_SIZE);
+	std::vector<unsigned int> reference(objectCount + CULL_BATCH_SIZE);
+	const CullVolume volumes[] = { CULL_SPHERES, CULL_BOXES };
+	for (int v = 0; v < 2; v++)
+	{
+		size_t referenceCount = 0;
+		for (int simd = 0; simd < 2; simd++)
+		{
+			std::vector<unsigned int> &output = simd ? visible : reference;
+			size_t kept = 0;
+			std::vector<double> samples = timeRuns(options, [&]() {
+				kept = simd ? cullFrustum(frustum, bounds, volumes[v], 0, objectCount, output.data())
+					: cullFrustumScalar(frustum, bounds, volumes[v], 0, objectCount, output.data());
+			});
+			bool matches = true;
+			if (simd)
+				matches = checkSameVisible("FRUSTUM_CULL", reference, referenceCount, visible, kept);
+			else
+				referenceCount = kept;
+			double medianMs = summarizeTimings(samples).median;
+			report("frustum_cull", std::string("\"volume\": \"") + (volumes[v] == CULL_SPHERES ? "sphere" : "box")
+				+ "\", \"path\": \"" + (simd ? cullSimdPath() : "scalar") + "\", \"objects\": " + std::to_string(objectCount)
+				+ ", \"visible\": " + std::to_string(kept) + ", \"matches_scalar\": " + (matches ? "true" : "false")
+				+ ", \"ns_per_object\": " + std::to_string(medianMs * 1.0e6 / objectCount), samples);
+		}
+	}
+}
+
+// Bounding volume hierarchy
+// -------------------------
+// Random boxes at constant density around the frustum_cull camera, so the number visible stays about
+// the same while the scene grows: the linear SIMD test scales with the object count, the BVH with
+// the visible count and the tree depth. Builds are timed once, they take up to a second at 1M
+static void benchBvh(const BenchOptions &options)
+{
+	Frustum frustum;
+	makeBenchFrustum(frustum);
+
+	const unsigned int objectCounts[] = { 10000, 100000, 1000000 };
+	const unsigned int rayCount = 1000;
+	for (size_t c = 0; c < sizeof(objectCounts) / sizeof(objectCounts[0]); c++)
+	{
+		unsigned int objectCount = objectCounts[c];
+		float spread = std::cbrt((float)objectCount) * 4.0f;
+		std::mt19937 random(13);
+		std::uniform_real_distribution<float> position(-spread, spread);
+		std::uniform_real_distribution<float> size(0.1f, 2.0f);
+		std::uniform_real_distribution<float> move(-0.5f, 0.5f);
+		CullBounds bounds, moved;
+		bounds.resize(objectCount);
+		moved.resize(objectCount);
+		for (unsigned int i = 0; i < objectCount; i++)
+		{
+			float center[3] = { position(random), position(random), position(random) };
+			float extent[3] = { size(random), size(random), size(random) };
+			bounds.setBox(i, center, extent);
+			for (int axis = 0; axis < 3; axis++)
+				center[axis] += move(random);
+			moved.setBox(i, center, extent);
+		}
+		std::string params = "\"objects\": " + std::to_string(objectCount);
+
+		Bvh bvh;
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		bvh.build(bounds);
+		std::vector<double> buildSamples(1, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+		report("bvh", "\"mode\": \"build\", " + params + ", \"nodes\": " + std::to_string(bvh.getNodeCount())
+			+ ", \"sah_cost\": " + std::to_string(bvh.getBuildCost()), buildSamples);
+
+		// Alternates between the two positions of every object
+		bool flip = false;
+		std::vector<double> samples = timeRuns(options, [&]() {
+			bvh.refit(flip ? bounds : moved);
+			flip = !flip;
+		});
+		bvh.refit(bounds);
+		report("bvh", "\"mode\": \"refit\", " + params, samples);
+
+		std::vector<unsigned int> linear(objectCount + CULL_BATCH_SIZE), visible(objectCount + CULL_BATCH_SIZE);
+		size_t linearCount = 0, kept = 0;
+		samples = timeRuns(options, [&]() { linearCount = cullFrustum(frustum, bounds, CULL_BOXES, 0, objectCount, linear.data()); });
+		report("bvh", "\"mode\": \"cull_linear\", \"path\": \"" + std::string(cullSimdPath()) + "\", " + params
+			+ ", \"visible\": " + std::to_string(linearCount), samples);
+		samples = timeRuns(options, [&]() { kept = bvh.cullFrustum(frustum, bounds, visible.data()); });
+		// The tree emits in its own order, the linear cull in increasing order
+		std::sort(visible.begin(), visible.begin() + kept);
+		bool matches = checkSameVisible("BVH_CULL", linear, linearCount, visible, kept);
+		report("bvh", "\"mode\": \"cull_bvh\", " + params + ", \"visible\": " + std::to_string(kept)
+			+ ", \"matches_linear\": " + (matches ? "true" : "false")
+			+ ", \"nodes_visited\": " + std::to_string(bvh.getVisitedNodes()), samples);
+
+		// Picking rays from random points in the scene in random directions
+		std::vector<float> rays(rayCount * 6);
+		for (size_t i = 0; i < rays.size(); i++)
+			rays[i] = i % 6 < 3 ? position(random) : move(random);
+		unsigned int hits = 0;
+		unsigned long long visited = 0;
+		samples = timeRuns(options, [&]() {
+			hits = 0;
+			visited = 0;
+			for (unsigned int ray = 0; ray < rayCount; ray++)
+			{
+				float distance;
+				hits += bvh.raycast(&rays[ray * 6], &rays[ray * 6 + 3], bounds, distance) >= 0;
+				visited += bvh.getVisitedNodes();
+			}
+		});
+		report("bvh", "\"mode\": \"raycast\", " + params + ", \"rays\": " + std::to_string(rayCount)
+			+ ", \"hits\": " + std::to_string(hits) + ", \"nodes_visited_per_ray\": " + std::to_string((double)visited / rayCount), samples);
+	}
+}
+
+// Registry
+// --------
+struct Benchmark
+{
+	const char *name;
+	const char *description;
+	void (*run)(const BenchOptions &options);
+};
+
+static const Benchmark BENCHMARKS[] = {
+	{ "soft_raster", "CPU rasterizer frame time by instance and thread count", benchSoftRaster },
+	{ "render_queue", "Sort key build + radix sort time and resulting state changes", benchRenderQueue },
+	{ "job_system", "Serial vs work-stealing parallelFor, and per-job overhead, by thread count", benchJobSystem },
+	{ "command_record", "Recording draw commands into per-thread arenas by thread count", benchCommandRecord },
+	{ "mesh_import", "OBJ and binary PLY import throughput in MB/s by thread count", benchMeshImport },
+	{ "frustum_cull", "Scalar vs SIMD frustum test of 1M spheres and boxes", benchFrustumCull },
+	{ "bvh", "BVH build, refit, frustum culling vs the linear test, and ray picking by object count", benchBvh },
+	{ "vertex_quantize", "Position encode time, size and max error of the f32, u16 and i10 formats", benchVertexQuantize },
+};
+
+int main(int argc, char *argv[])
+{
+	BenchOptions options;
+	std::vector<std::string> selected;
+	for (int i = 1; i < argc; i++)
+	{
+		if (std::strcmp(argv[i], "--list") == 0)
+		{
+			for (size_t b = 0; b < sizeof(BENCHMARKS) / sizeof(BENCHMARKS[0]); b++)
+				std::cout << BENCHMARKS[b].name << "  " << BENCHMARKS[b].description << std::endl;
+			return 0;
+		}
+		else if (std::strcmp(argv[i], "--iterations") == 0 && i + 1 < argc)
+			options.iterations = (unsigned int)std::strtoul(argv[++i], NULL, 10);
+		else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+			options.threads = (unsigned int)std::strtoul(argv[++i], NULL, 10);
+		else if (argv[i][0] == '-')
+		{
+			std::cout << "Usage: " << argv[0] << " [--list] [--iterations N] [--threads N] [name...]" << std::endl;
+			return -1;
+		}
+		else
+			selected.push_back(argv[i]);
+	}
+
+	int ran = 0;
+	for (size_t b = 0; b < sizeof(BENCHMARKS) / sizeof(BENCHMARKS[0]); b++)
+	{
+		bool wanted = selected.empty();
+		for (size_t s = 0; s < selected.size(); s++)
+			wanted = wanted || selected[s] == BENCHMARKS[b].name;
+		if (wanted)
+		{
+			BENCHMARKS[b].run(options);
+			ran++;
+		}
+	}
+	if (ran == 0)
+	{
+		std::cout << "ERROR::BENCH::UNKNOWN_BENCHMARK" << std::endl;
+		return -1;
+	}
+	return 0;
+}
@@ -0,0 +1,406 @@
+#include "bvh.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+// Cost of visiting an inner node relative to testing one object's box, which also sets the leaf size:
+// with 2, leaves end up holding 1 to 4 objects
+static const float TRAVERSAL_COST = 2.0f;
+
+// Box helpers
+// -----------
+struct Box
+{
+	float min[3];
+	float max[3];
+};
+
+static void clearBox(Box &box)
+{
+	for (int axis = 0; axis < 3; axis++)
+	{
+		box.min[axis] = std::numeric_limits<float>::max();
+		box.max[axis] = -std::numeric_limits<float>::max();
+	}
+}
+
+static void growBox(Box &box, const float min[3], const float max[3])
+{
+	for (int axis = 0; axis < 3; axis++)
+	{
+		box.min[axis] = std::min(box.min[axis], min[axis]);
+		box.max[axis] = std::max(box.max[axis], max[axis]);
+	}
+}
+
+static void getObjectBox(const CullBounds &bounds, unsigned int object, float min[3], float max[3])
+{
+	for (int axis = 0; axis < 3; axis++)
+	{
+		float center = bounds.getCenter(axis)[object];
+		float extent = bounds.getExtent(axis)[object];
+		min[axis] = center - extent;
+		max[axis] = center + extent;
+	}
+}
+
+static float surfaceArea(const float min[3], const float max[3])
+{
+	float dx = max[0] - min[0], dy = max[1] - min[1], dz = max[2] - min[2];
+	if (dx < 0.0f || dy < 0.0f || dz < 0.0f)
+		return 0.0f;
+	return 2.0f * (dx * dy + dy * dz + dz * dx);
+}
+
+// Expected cost of a query, each node weighted by the chance a random ray through the root hits it
+static float computeSahCost(const std::vector<BvhNode> &nodes)
+{
+	if (nodes.empty())
+		return 0.0f;
+	float rootArea = surfaceArea(nodes[0].boundsMin, nodes[0].boundsMax);
+	if (rootArea <= 0.0f)
+		return 0.0f;
+	float cost = 0.0f;
+	for (size_t i = 0; i < nodes.size(); i++)
+		cost += surfaceArea(nodes[i].boundsMin, nodes[i].boundsMax) * (nodes[i].count ? (float)nodes[i].count : TRAVERSAL_COST);
+	return cost / rootArea;
+}
+
+// Entry parameter of the ray in the box, false when it misses or the box is behind the origin
+static bool intersectRay(const float min[3], const float max[3], const float origin[3], const float inverseDirection[3],
+	float &entry)
+{
+	float enter = 0.0f;
+	float exit = std::numeric_limits<float>::max();
+	for (int axis = 0; axis < 3; axis++)
+	{
+		if (std::isinf(inverseDirection[axis]))
+		{
+			// Parallel to the slab, inside it or never
+			if (origin[axis] < min[axis] || origin[axis] > max[axis])
+				return false;
+			continue;
+		}
+		float t0 = (min[axis] - origin[axis]) * inverseDirection[axis];
+		float t1 = (max[axis] - origin[axis]) * inverseDirection[axis];
+		enter = std::max(enter, std::min(t0, t1));
+		exit = std::min(exit, std::max(t0, t1));
+	}
+	entry = enter;
+	return enter <= exit;
+}
+
+// Build
+// -----
+void Bvh::build(const CullBounds &bounds)
+{
+	unsigned int count = (unsigned int)bounds.size();
+	nodes.clear();
+	objects.resize(count);
+	for (unsigned int i = 0; i < count; i++)
+		objects[i] = i;
+	if (count == 0)
+	{
+		cost = buildCost = 0.0f;
+		return;
+	}
+	// A binary tree with at least one object per leaf has fewer than 2 * count nodes
+	nodes.reserve(2 * (size_t)count);
+	buildNode(bounds, 0, count);
+	cost = buildCost = computeSahCost(nodes);
+}
+
+unsigned int Bvh::buildNode(const CullBounds &bounds, unsigned int first, unsigned int count)
+{
+	unsigned int index = (unsigned int)nodes.size();
+	nodes.push_back(BvhNode());
+
+	Box box, centroids;
+	clearBox(box);
+	clearBox(centroids);
+	for (unsigned int i = first; i < first + count; i++)
+	{
+		float min[3], max[3], center[3];
+		getObjectBox(bounds, objects[i], min, max);
+		growBox(box, min, max);
+		for (int axis = 0; axis < 3; axis++)
+			center[axis] = bounds.getCenter(axis)[objects[i]];
+		growBox(centroids, center, center);
+	}
+	std::memcpy(nodes[index].boundsMin, box.min, sizeof(box.min));
+	std::memcpy(nodes[index].boundsMax, box.max, sizeof(box.max));
+
+	int axis = 0;
+	for (int other = 1; other < 3; other++)
+		if (centroids.max[other] - centroids.min[other] > centroids.max[axis] - centroids.min[axis])
+			axis = other;
+	float extent = centroids.max[axis] - centroids.min[axis];
+	const float *centers = bounds.getCenter(axis);
+
+	unsigned int middle = first;
+	if (count > 1 && extent > 0.0f)
+	{
+		// Bin the centroids, then sweep the BVH_SAH_BINS - 1 planes between bins from both sides
+		float binScale = BVH_SAH_BINS / extent;
+		auto binOf = [&](unsigned int object) {
+			return std::min(BVH_SAH_BINS - 1, (unsigned int)((centers[object] - centroids.min[axis]) * binScale));
+		};
+		Box bins[BVH_SAH_BINS];
+		unsigned int binCounts[BVH_SAH_BINS] = {};
+		for (unsigned int bin = 0; bin < BVH_SAH_BINS; bin++)
+			clearBox(bins[bin]);
+		for (unsigned int i = first; i < first + count; i++)
+		{
+			float min[3], max[3];
+			getObjectBox(bounds, objects[i], min, max);
+			unsigned int bin = binOf(objects[i]);
+			growBox(bins[bin], min, max);
+			binCounts[bin]++;
+		}
+
+		float leftCost[BVH_SAH_BINS - 1];
+		Box sweep;
+		clearBox(sweep);
+		unsigned int sweepCount = 0;
+		for (unsigned int plane = 0; plane < BVH_SAH_BINS - 1; plane++)
+		{
+			growBox(sweep, bins[plane].min, bins[plane].max);
+			sweepCount += binCounts[plane];
+			leftCost[plane] = sweepCount * surfaceArea(sweep.min, sweep.max);
+		}
+		clearBox(sweep);
+		sweepCount = 0;
+		float bestCost = std::numeric_limits<float>::max();
+		unsigned int bestPlane = 0;
+		for (unsigned int plane = BVH_SAH_BINS - 1; plane > 0; plane--)
+		{
+			growBox(sweep, bins[plane].min, bins[plane].max);
+			sweepCount += binCounts[plane];
+			float planeCost = leftCost[plane - 1] + sweepCount * surfaceArea(sweep.min, sweep.max);
+			if (sweepCount > 0 && sweepCount < count && planeCost < bestCost)
+			{
+				bestCost = planeCost;
+				bestPlane = plane - 1;
+			}
+		}
+
+		// Split when it beats testing every object here, or when the leaf would be too big
+		float area = surfaceArea(box.min, box.max);
+		float splitCost = TRAVERSAL_COST + (area > 0.0f ? bestCost / area : 0.0f);
+		if (bestCost < std::numeric_limits<float>::max() && (splitCost < count || count > BVH_MAX_LEAF_SIZE))
+			middle = (unsigned int)(std::partition(objects.begin() + first, objects.begin() + first + count,
+				[&](unsigned int object) { return binOf(object) <= bestPlane; }) - objects.begin());
+	}
+	if (middle == first && count > BVH_MAX_LEAF_SIZE)
+	{
+		// Coincident centroids: halve by count
+		middle = first + count / 2;
+		std::nth_element(objects.begin() + first, objects.begin() + middle, objects.begin() + first + count,
+			[&](unsigned int a, unsigned int b) { return centers[a] < centers[b]; });
+	}
+
+	if (middle == first)
+	{
+		nodes[index].offset = first;
+		nodes[index].count = count;
+		return index;
+	}
+	// Children are appended after this node, which may move it; only the index is held on to
+	buildNode(bounds, first, middle - first);
+	unsigned int second = buildNode(bounds, middle, first + count - middle);
+	nodes[index].offset = second;
+	nodes[index].count = 0;
+	return index;
+}
+
+void Bvh::refit(const CullBounds &bounds)
+{
+	// Children always come after their parent, so walking backwards finishes them first
+	for (size_t i = nodes.size(); i-- > 0;)
+	{
+		BvhNode &node = nodes[i];
+		Box box;
+		clearBox(box);
+		if (node.count)
+			for (unsigned int j = node.offset; j < node.offset + node.count; j++)
+			{
+				float min[3], max[3];
+				getObjectBox(bounds, objects[j], min, max);
+				growBox(box, min, max);
+			}
+		else
+		{
+			growBox(box, nodes[i + 1].boundsMin, nodes[i + 1].boundsMax);
+			growBox(box, nodes[node.offset].boundsMin, nodes[node.offset].boundsMax);
+		}
+		std::memcpy(node.boundsMin, box.min, sizeof(box.min));
+		std::memcpy(node.boundsMax, box.max, sizeof(box.max));
+	}
+	cost = computeSahCost(nodes);
+}
+
+// Queries
+// -------
+// Outside when the box's center is further than its reach behind the plane, fully inside when it's at
+// least its reach in front; the same test as cullFrustum() on CULL_BOXES
+enum PlaneSide { PLANE_OUTSIDE, PLANE_INTERSECTING, PLANE_INSIDE };
+
+static PlaneSide classifyBox(const float plane[4], const float center[3], const float extent[3])
+{
+	float distance = plane[0] * center[0] + plane[1] * center[1] + plane[2] * center[2] + plane[3];
+	float reach = std::fabs(plane[0]) * extent[0] + std::fabs(plane[1]) * extent[1] + std::fabs(plane[2]) * extent[2];
+	if (distance < -reach)
+		return PLANE_OUTSIDE;
+	return distance >= reach ? PLANE_INSIDE : PLANE_INTERSECTING;
+}
+
+void Bvh::emitSubtree(unsigned int node, unsigned int *visible, size_t &kept) const
+{
+	// The subtree's objects run from its leftmost leaf to its rightmost one
+	unsigned int leftmost = node, rightmost = node;
+	while (!nodes[leftmost].count)
+		leftmost++;
+	while (!nodes[rightmost].count)
+		rightmost = nodes[rightmost].offset;
+	unsigned int first = nodes[leftmost].offset;
+	unsigned int last = nodes[rightmost].offset + nodes[rightmost].count;
+	std::memcpy(visible + kept, &objects[first], (last - first) * sizeof(unsigned int));
+	kept += last - first;
+}
+
+size_t Bvh::cullFrustum(const Frustum &frustum, const CullBounds &bounds, unsigned int *visible) const
+{
+	visited = 0;
+	size_t kept = 0;
+	if (nodes.empty())
+		return 0;
+
+	// Node and the planes its box still straddles, one bit per plane
+	struct Entry
+	{
+		unsigned int node;
+		unsigned int planes;
+	};
+	std::vector<Entry> stack;
+	stack.reserve(64);
+	stack.push_back({ 0, 0x3F });
+	while (!stack.empty())
+	{
+		Entry entry = stack.back();
+		stack.pop_back();
+		const BvhNode &node = nodes[entry.node];
+		visited++;
+
+		float center[3], extent[3];
+		for (int axis = 0; axis < 3; axis++)
+		{
+			center[axis] = (node.boundsMin[axis] + node.boundsMax[axis]) * 0.5f;
+			extent[axis] = (node.boundsMax[axis] - node.boundsMin[axis]) * 0.5f;
+		}
+		bool outside = false;
+		for (int plane = 0; plane < 6 && !outside; plane++)
+			if (entry.planes & (1u << plane))
+			{
+				PlaneSide side = classifyBox(frustum.planes[plane], center, extent);
+				outside = side == PLANE_OUTSIDE;
+				if (side == PLANE_INSIDE)
+					entry.planes &= ~(1u << plane);
+			}
+		if (outside)
+			continue;
+
+		if (!entry.planes)
+			emitSubtree(entry.node, visible, kept);
+		else if (node.count)
+		{
+			for (unsigned int i = node.offset; i < node.offset + node.count; i++)
+			{
+				unsigned int object = objects[i];
+				float objectCenter[3], objectExtent[3];
+				for (int axis = 0; axis < 3; axis++)
+				{
+					objectCenter[axis] = bounds.getCenter(axis)[object];
+					objectExtent[axis] = bounds.getExtent(axis)[object];
+				}
+				bool inside = true;
+				for (int plane = 0; plane < 6 && inside; plane++)
+					if (entry.planes & (1u << plane))
+						inside = classifyBox(frustum.planes[plane], objectCenter, objectExtent) != PLANE_OUTSIDE;
+				if (inside)
+					visible[kept++] = object;
+			}
+		}
+		else
+		{
+			// First child on top, so the output follows the object order of the tree
+			stack.push_back({ node.offset, entry.planes });
+			stack.push_back({ entry.node + 1, entry.planes });
+		}
+	}
+	return kept;
+}
+
+int Bvh::raycast(const float origin[3], const float direction[3], const CullBounds &bounds, float &distance) const
+{
+	visited = 0;
+	int hit = -1;
+	float inverseDirection[3];
+	for (int axis = 0; axis < 3; axis++)
+		inverseDirection[axis] = 1.0f / direction[axis];
+	float best = std::numeric_limits<float>::max();
+	float rootEntry;
+	if (nodes.empty() || !intersectRay(nodes[0].boundsMin, nodes[0].boundsMax, origin, inverseDirection, rootEntry))
+		return -1;
+
+	// Nodes the ray enters, with the entry parameter; the nearer child is visited first, so once
+	// something is hit every node entered beyond it is skipped
+	struct Entry
+	{
+		unsigned int node;
+		float entry;
+	};
+	std::vector<Entry> stack;
+	stack.reserve(64);
+	stack.push_back({ 0, rootEntry });
+	while (!stack.empty())
+	{
+		Entry entry = stack.back();
+		stack.pop_back();
+		if (entry.entry > best)
+			continue;
+		const BvhNode &node = nodes[entry.node];
+		visited++;
+
+		if (node.count)
+		{
+			for (unsigned int i = node.offset; i < node.offset + node.count; i++)
+			{
+				float min[3], max[3], objectEntry;
+				getObjectBox(bounds, objects[i], min, max);
+				if (intersectRay(min, max, origin, inverseDirection, objectEntry) && objectEntry < best)
+				{
+					best = objectEntry;
+					hit = (int)objects[i];
+				}
+			}
+			continue;
+		}
+
+		unsigned int children[2] = { entry.node + 1, node.offset };
+		float entries[2];
+		bool hits[2];
+		for (int child = 0; child < 2; child++)
+			hits[child] = intersectRay(nodes[children[child]].boundsMin, nodes[children[child]].boundsMax,
+				origin, inverseDirection, entries[child]) && entries[child] <= best;
+		int nearer = hits[0] && hits[1] ? (entries[1] < entries[0] ? 1 : 0) : (hits[1] ? 1 : 0);
+		if (hits[1 - nearer])
+			stack.push_back({ children[1 - nearer], entries[1 - nearer] });
+		if (hits[nearer])
+			stack.push_back({ children[nearer], entries[nearer] });
+	}
+	if (hit >= 0)
+		distance = best;
+	return hit;
+}
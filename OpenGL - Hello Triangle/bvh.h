@@ -0,0 +1,68 @@
+#ifndef BVH_H
+#define BVH_H
+
+#include "frustum_cull.h"
+
+#include <cstddef>
+#include <vector>
+
+// Node of the flattened hierarchy, 32 bytes so two share a cache line
+// Nodes are stored depth first: an inner node's first child directly follows it and every subtree
+// is a contiguous run of nodes, whose leaves cover a contiguous run of the object list
+// -----------------------------------------------------------------------------------------------
+struct BvhNode
+{
+	float boundsMin[3];
+	// Leaf: first entry of the object list, inner node: index of the second child
+	unsigned int offset;
+	float boundsMax[3];
+	// Objects in the leaf, 0 for inner nodes
+	unsigned int count;
+};
+
+// Bounding volume hierarchy over the boxes of a CullBounds, for frustum culling and ray picking
+// in time logarithmic in the object count
+// Built top down with the surface area heuristic, evaluated over BVH_SAH_BINS bins of the widest
+// centroid axis. Moving objects are handled by refitting the boxes bottom up, which keeps the
+// tree but lets its quality drift; rebuild once getCost() grows well past getBuildCost()
+// ----------------------------------------------------------------------------------------------
+const unsigned int BVH_SAH_BINS = 16;
+// Leaves never hold more objects, and are split further while the SAH finds it cheaper
+const unsigned int BVH_MAX_LEAF_SIZE = 8;
+
+class Bvh
+{
+public:
+	void build(const CullBounds &bounds);
+	// Recomputes every node's box from the current bounds of the same objects
+	void refit(const CullBounds &bounds);
+
+	// Writes the indices of the objects whose boxes intersect the frustum to visible, in tree order,
+	// and returns how many there are; visible needs room for every object. Subtrees entirely inside
+	// are emitted without testing their objects, planes a node is entirely inside aren't tested below it
+	size_t cullFrustum(const Frustum &frustum, const CullBounds &bounds, unsigned int *visible) const;
+
+	// Index of the object whose box the ray enters first, -1 when it misses everything. distance
+	// is then the ray parameter of the entry point, in units of direction's length
+	int raycast(const float origin[3], const float direction[3], const CullBounds &bounds, float &distance) const;
+
+	// Expected cost of a query relative to testing the root's box, from the node areas
+	float getCost() const { return cost; }
+	float getBuildCost() const { return buildCost; }
+	size_t getNodeCount() const { return nodes.size(); }
+	// Nodes visited by the last cullFrustum() or raycast()
+	unsigned int getVisitedNodes() const { return visited; }
+
+private:
+	unsigned int buildNode(const CullBounds &bounds, unsigned int first, unsigned int count);
+	void emitSubtree(unsigned int node, unsigned int *visible, size_t &kept) const;
+
+	std::vector<BvhNode> nodes;
+	// Object indices, permuted so every leaf's objects are contiguous
+	std::vector<unsigned int> objects;
+	float cost = 0.0f;
+	float buildCost = 0.0f;
+	mutable unsigned int visited = 0;
+};
+
+#endif
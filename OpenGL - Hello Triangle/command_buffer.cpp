@@ -0,0 +1,284 @@
+#include <glad/glad.h>
+
+#include "command_buffer.h"
+#include "gl_state.h"
+#include "job_system.h"
+
+#include <algorithm>
+
+// LinearArena
+// -----------
+void *LinearArena::allocate(size_t size, size_t alignment)
+{
+	if (blocksUsed > 0)
+	{
+		Block &block = blocks[blocksUsed - 1];
+		size_t offset = (block.used + alignment - 1) / alignment * alignment;
+		if (offset + size <= block.data.size())
+		{
+			block.used = offset + size;
+			return block.data.data() + offset;
+		}
+	}
+
+	// Move on to the next block big enough, blocks skipped over stay empty
+	while (blocksUsed < blocks.size() && blocks[blocksUsed].data.size() < size)
+		blocksUsed++;
+	if (blocksUsed == blocks.size())
+	{
+		blocks.push_back(Block());
+		blocks.back().data.resize(std::max(BLOCK_SIZE, size));
+	}
+	Block &block = blocks[blocksUsed++];
+	block.used = size;
+	return block.data.data();
+}
+
+void LinearArena::reset()
+{
+	for (size_t i = 0; i < blocks.size(); i++)
+		blocks[i].used = 0;
+	blocksUsed = 0;
+}
+
+const unsigned char *LinearArena::getBlock(size_t block, size_t &used) const
+{
+	used = blocks[block].used;
+	return blocks[block].data.data();
+}
+
+size_t LinearArena::getBytesUsed() const
+{
+	size_t bytes = 0;
+	for (size_t i = 0; i < blocksUsed; i++)
+		bytes += blocks[i].used;
+	return bytes;
+}
+
+// Command encoding
+// ----------------
+// Every command starts with a header giving its type and the bytes up to the next command;
+// sizes are multiples of 8 so headers stay aligned without padding
+enum CommandType
+{
+	COMMAND_BIND_PROGRAM,
+	COMMAND_BIND_VERTEX_ARRAY,
+	COMMAND_BIND_TEXTURE,
+	COMMAND_SET_INSTANCE,
+	COMMAND_DRAW_ELEMENTS,
+	COMMAND_DRAW_ELEMENTS_INSTANCED,
+	COMMAND_UPLOAD_BUFFER
+};
+
+struct CommandHeader
+{
+	unsigned int type;
+	unsigned int size;
+};
+
+struct BindCommand
+{
+	unsigned int name;
+};
+
+struct BindTextureCommand
+{
+	unsigned int unit;
+	unsigned int target;
+	unsigned int texture;
+};
+
+struct DrawElementsCommand
+{
+	unsigned int indexCount;
+	unsigned int indexType;
+	unsigned int instanceCount;
+	int baseVertex;
+	size_t indexOffset;
+};
+
+// Followed by size bytes of data
+struct UploadBufferCommand
+{
+	unsigned int target;
+	unsigned int buffer;
+	size_t offset;
+	size_t size;
+};
+
+static const size_t COMMAND_ALIGNMENT = 8;
+
+// CommandBuffer
+// -------------
+void CommandBuffer::reset()
+{
+	arena.reset();
+	commandCount = 0;
+}
+
+void *CommandBuffer::append(unsigned int type, size_t size)
+{
+	size_t total = (sizeof(CommandHeader) + size + COMMAND_ALIGNMENT - 1) / COMMAND_ALIGNMENT * COMMAND_ALIGNMENT;
+	CommandHeader *header = (CommandHeader *)arena.allocate(total, COMMAND_ALIGNMENT);
+	header->type = type;
+	header->size = (unsigned int)total;
+	commandCount++;
+	return header + 1;
+}
+
+void CommandBuffer::bindProgram(unsigned int program)
+{
+	BindCommand *command = (BindCommand *)append(COMMAND_BIND_PROGRAM, sizeof(BindCommand));
+	command->name = program;
+}
+
+void CommandBuffer::bindVertexArray(unsigned int vertexArray)
+{
+	BindCommand *command = (BindCommand *)append(COMMAND_BIND_VERTEX_ARRAY, sizeof(BindCommand));
+	command->name = vertexArray;
+}
+
+void CommandBuffer::bindTexture(unsigned int unit, unsigned int target, unsigned int texture)
+{
+	BindTextureCommand *command = (BindTextureCommand *)append(COMMAND_BIND_TEXTURE, sizeof(BindTextureCommand));
+	command->unit = unit;
+	command->target = target;
+	command->texture = texture;
+}
+
+void CommandBuffer::setInstance(const InstanceData &instance)
+{
+	InstanceData *command = (InstanceData *)append(COMMAND_SET_INSTANCE, sizeof(InstanceData));
+	*command = instance;
+}
+
+void CommandBuffer::drawElements(unsigned int indexCount, unsigned int indexType, size_t indexOffset, int baseVertex)
+{
+	DrawElementsCommand *command = (DrawElementsCommand *)append(COMMAND_DRAW_ELEMENTS, sizeof(DrawElementsCommand));
+	command->indexCount = indexCount;
+	command->indexType = indexType;
+	command->instanceCount = 1;
+	command->baseVertex = baseVertex;
+	command->indexOffset = indexOffset;
+}
+
+void CommandBuffer::drawElementsInstanced(unsigned int indexCount, unsigned int indexType, unsigned int instanceCount)
+{
+	DrawElementsCommand *command = (DrawElementsCommand *)append(COMMAND_DRAW_ELEMENTS_INSTANCED, sizeof(DrawElementsCommand));
+	command->indexCount = indexCount;
+	command->indexType = indexType;
+	command->instanceCount = instanceCount;
+	command->baseVertex = 0;
+	command->indexOffset = 0;
+}
+
+void *CommandBuffer::uploadBuffer(unsigned int target, unsigned int buffer, size_t offset, size_t size)
+{
+	UploadBufferCommand *command = (UploadBufferCommand *)append(COMMAND_UPLOAD_BUFFER, sizeof(UploadBufferCommand) + size);
+	command->target = target;
+	command->buffer = buffer;
+	command->offset = offset;
+	command->size = size;
+	return command + 1;
+}
+
+void CommandBuffer::execute() const
+{
+	for (size_t block = 0; block < arena.getBlockCount(); block++)
+	{
+		size_t used = 0;
+		const unsigned char *data = arena.getBlock(block, used);
+		for (size_t position = 0; position < used; )
+		{
+			const CommandHeader *header = (const CommandHeader *)(data + position);
+			const void *command = header + 1;
+			switch (header->type)
+			{
+			case COMMAND_BIND_PROGRAM:
+				glState.useProgram(((const BindCommand *)command)->name);
+				break;
+			case COMMAND_BIND_VERTEX_ARRAY:
+				glState.bindVertexArray(((const BindCommand *)command)->name);
+				break;
+			case COMMAND_BIND_TEXTURE:
+			{
+				const BindTextureCommand *bind = (const BindTextureCommand *)command;
+				glState.activeTexture(bind->unit);
+				glState.bindTexture(bind->target, bind->texture);
+				break;
+			}
+			case COMMAND_SET_INSTANCE:
+			{
+				const InstanceData *instance = (const InstanceData *)command;
+				glVertexAttrib3f(INSTANCE_OFFSET_SCALE_LOCATION, instance->offset[0], instance->offset[1], instance->scale);
+				glVertexAttrib4fv(INSTANCE_COLOR_LOCATION, instance->color);
+				break;
+			}
+			case COMMAND_DRAW_ELEMENTS:
+			{
+				const DrawElementsCommand *draw = (const DrawElementsCommand *)command;
+				if (draw->baseVertex)
+					glDrawElementsBaseVertex(GL_TRIANGLES, draw->indexCount, draw->indexType, (void*)draw->indexOffset, draw->baseVertex);
+				else
+					glDrawElements(GL_TRIANGLES, draw->indexCount, draw->indexType, (void*)draw->indexOffset);
+				break;
+			}
+			case COMMAND_DRAW_ELEMENTS_INSTANCED:
+			{
+				const DrawElementsCommand *draw = (const DrawElementsCommand *)command;
+				glDrawElementsInstanced(GL_TRIANGLES, draw->indexCount, draw->indexType, (void*)draw->indexOffset, draw->instanceCount);
+				break;
+			}
+			case COMMAND_UPLOAD_BUFFER:
+			{
+				const UploadBufferCommand *upload = (const UploadBufferCommand *)command;
+				glState.bindBuffer(upload->target, upload->buffer);
+				glBufferSubData(upload->target, upload->offset, upload->size, upload + 1);
+				break;
+			}
+			}
+			position += header->size;
+		}
+	}
+}
+
+// ParallelRecorder
+// ----------------
+void ParallelRecorder::init(JobSystem &jobSystem)
+{
+	jobs = &jobSystem;
+	buffers.resize(jobSystem.getThreadCount());
+}
+
+void ParallelRecorder::record(const std::function<void(unsigned int slice, CommandBuffer &buffer)> &task)
+{
+	jobs->parallelFor(buffers.size(), 1, [&](size_t first, size_t last) {
+		for (size_t slice = first; slice < last; slice++)
+		{
+			buffers[slice].reset();
+			task((unsigned int)slice, buffers[slice]);
+		}
+	});
+}
+
+void ParallelRecorder::execute() const
+{
+	for (size_t i = 0; i < buffers.size(); i++)
+		buffers[i].execute();
+}
+
+unsigned int ParallelRecorder::getCommandCount() const
+{
+	unsigned int count = 0;
+	for (size_t i = 0; i < buffers.size(); i++)
+		count += buffers[i].getCommandCount();
+	return count;
+}
+
+size_t ParallelRecorder::getBytesUsed() const
+{
+	size_t bytes = 0;
+	for (size_t i = 0; i < buffers.size(); i++)
+		bytes += buffers[i].getBytesUsed();
+	return bytes;
+}
@@ -0,0 +1,102 @@
+#ifndef COMMAND_BUFFER_H
+#define COMMAND_BUFFER_H
+
+#include "instancing.h"
+
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+class JobSystem;
+
+// Bump allocator over a list of fixed-size blocks
+// reset() rewinds to the first block without freeing, so a steady-state frame allocates nothing
+// Requests larger than a block get a block of their own
+// ---------------------------------------------------------------------------------------------
+class LinearArena
+{
+public:
+	static const size_t BLOCK_SIZE = 64 * 1024;
+
+	void *allocate(size_t size, size_t alignment);
+	void reset();
+
+	// Blocks written since the last reset, in allocation order, and the bytes used in each
+	size_t getBlockCount() const { return blocksUsed; }
+	const unsigned char *getBlock(size_t block, size_t &used) const;
+
+	size_t getBytesUsed() const;
+
+private:
+	struct Block
+	{
+		std::vector<unsigned char> data;
+		size_t used;
+	};
+
+	std::vector<Block> blocks;
+	size_t blocksUsed = 0;
+};
+
+// Compact list of GL commands recorded on any thread and executed later on the GL thread
+// Commands and their payloads (e.g. buffer uploads) are packed back to back in a LinearArena;
+// nothing touches GL until execute(), which binds through glState so redundant binds between
+// buffers are still dropped
+// --------------------------------------------------------------------------------------------
+class CommandBuffer
+{
+public:
+	// Drops the recorded commands, keeping the memory
+	void reset();
+
+	void bindProgram(unsigned int program);
+	void bindVertexArray(unsigned int vertexArray);
+	// unit is the GL enum, e.g. GL_TEXTURE0
+	void bindTexture(unsigned int unit, unsigned int target, unsigned int texture);
+	// Sets the per-instance attributes as generic values for the following non-instanced draws
+	void setInstance(const InstanceData &instance);
+	// Triangles from the bound element buffer, indexType is GL_UNSIGNED_BYTE, _SHORT or _INT
+	void drawElements(unsigned int indexCount, unsigned int indexType, size_t indexOffset, int baseVertex);
+	void drawElementsInstanced(unsigned int indexCount, unsigned int indexType, unsigned int instanceCount);
+	// glBufferSubData of size bytes, returns the payload to fill in; it must be written before execute()
+	void *uploadBuffer(unsigned int target, unsigned int buffer, size_t offset, size_t size);
+
+	// Issues every command in recording order, call on the thread the context is current on
+	void execute() const;
+
+	unsigned int getCommandCount() const { return commandCount; }
+	size_t getBytesUsed() const { return arena.getBytesUsed(); }
+
+private:
+	void *append(unsigned int type, size_t size);
+
+	LinearArena arena;
+	unsigned int commandCount = 0;
+};
+
+// Runs a recording task on the job system's workers, each writing its own CommandBuffer, and replays
+// the buffers on the GL thread in order, so the command stream is deterministic
+// ---------------------------------------------------------------------------------------------------
+class ParallelRecorder
+{
+public:
+	// One buffer per job system worker
+	void init(JobSystem &jobSystem);
+	unsigned int getThreadCount() const { return (unsigned int)buffers.size(); }
+
+	// Resets every buffer and calls task(slice, buffer) once per buffer, spread over the workers
+	// Returns once all slices are recorded
+	void record(const std::function<void(unsigned int slice, CommandBuffer &buffer)> &task);
+
+	// Executes the buffers in slice order, on the GL thread
+	void execute() const;
+
+	unsigned int getCommandCount() const;
+	size_t getBytesUsed() const;
+
+private:
+	JobSystem *jobs = NULL;
+	std::vector<CommandBuffer> buffers;
+};
+
+#endif
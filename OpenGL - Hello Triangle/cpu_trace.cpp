@@ -0,0 +1,120 @@
+#include "cpu_trace.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+bool cpuTraceEnabled = false;
+
+struct TraceEvent
+{
+	const char *name;
+	long long begin;
+	long long end;
+};
+
+struct TraceRing
+{
+	std::vector<TraceEvent> events;
+	// Events ever written, the newest is at (head - 1) % CPU_TRACE_MAX_EVENTS
+	std::atomic<unsigned long long> head;
+	std::string threadName;
+	unsigned int threadId;
+};
+
+// Rings outlive their threads so the exporter can still read them
+static std::mutex ringsMutex;
+static std::vector<std::unique_ptr<TraceRing> > rings;
+static long long traceStart = 0;
+
+static thread_local TraceRing *threadRing = NULL;
+
+// Registers the calling thread's ring on its first event, the only time a lock is taken
+static TraceRing &getThreadRing()
+{
+	if (!threadRing)
+	{
+		std::unique_ptr<TraceRing> ring(new TraceRing());
+		ring->events.resize(CPU_TRACE_MAX_EVENTS);
+		ring->head.store(0, std::memory_order_relaxed);
+
+		std::lock_guard<std::mutex> lock(ringsMutex);
+		ring->threadId = (unsigned int)rings.size() + 1;
+		ring->threadName = ring->threadId == 1 ? "main" : "thread " + std::to_string(ring->threadId);
+		threadRing = ring.get();
+		rings.push_back(std::move(ring));
+	}
+	return *threadRing;
+}
+
+void cpuTraceEnable()
+{
+	traceStart = cpuTraceNow();
+	cpuTraceEnabled = true;
+	// The enabling thread is the main thread, give it the first ring
+	getThreadRing();
+}
+
+void cpuTraceSetThreadName(const char *name)
+{
+	if (!cpuTraceEnabled)
+		return;
+	TraceRing &ring = getThreadRing();
+	std::lock_guard<std::mutex> lock(ringsMutex);
+	ring.threadName = name;
+}
+
+void cpuTraceRecord(const char *name, long long begin, long long end)
+{
+	TraceRing &ring = getThreadRing();
+	unsigned long long head = ring.head.load(std::memory_order_relaxed);
+	TraceEvent &event = ring.events[head % CPU_TRACE_MAX_EVENTS];
+	event.name = name;
+	event.begin = begin;
+	event.end = end;
+	ring.head.store(head + 1, std::memory_order_release);
+}
+
+void writeCpuTrace(std::ostream &out)
+{
+	std::streamsize precision = out.precision(3);
+	std::ios::fmtflags flags = out.setf(std::ios::fixed, std::ios::floatfield);
+
+	std::lock_guard<std::mutex> lock(ringsMutex);
+	out << "{ \"displayTimeUnit\": \"ms\", \"traceEvents\": [";
+	bool first = true;
+	for (size_t r = 0; r < rings.size(); r++)
+	{
+		TraceRing &ring = *rings[r];
+		out << (first ? "\n" : ",\n") << "{ \"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << ring.threadId
+			<< ", \"args\": { \"name\": \"" << ring.threadName << "\" } }";
+		first = false;
+
+		// Copy the live part of the ring, then drop whatever the owner overwrote during the copy
+		unsigned long long head = ring.head.load(std::memory_order_acquire);
+		unsigned long long oldest = head > CPU_TRACE_MAX_EVENTS ? head - CPU_TRACE_MAX_EVENTS : 0;
+		std::vector<TraceEvent> events;
+		events.reserve((size_t)(head - oldest));
+		for (unsigned long long i = oldest; i < head; i++)
+			events.push_back(ring.events[i % CPU_TRACE_MAX_EVENTS]);
+		// The slot of the event being written next is unsafe too
+		std::atomic_thread_fence(std::memory_order_acquire);
+		unsigned long long newHead = ring.head.load(std::memory_order_acquire);
+		unsigned long long intact = newHead + 1 > CPU_TRACE_MAX_EVENTS ? newHead + 1 - CPU_TRACE_MAX_EVENTS : 0;
+		size_t skip = intact > oldest ? (size_t)std::min(intact - oldest, head - oldest) : 0;
+
+		for (size_t i = skip; i < events.size(); i++)
+		{
+			const TraceEvent &event = events[i];
+			out << ",\n{ \"name\": \"" << event.name << "\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << ring.threadId
+				<< ", \"ts\": " << (event.begin - traceStart) / 1000.0 << ", \"dur\": " << (event.end - event.begin) / 1000.0 << " }";
+		}
+	}
+	out << "\n] }" << std::endl;
+
+	out.precision(precision);
+	out.flags(flags);
+}
@@ -0,0 +1,68 @@
+#ifndef CPU_TRACE_H
+#define CPU_TRACE_H
+
+#include <chrono>
+#include <ostream>
+
+// CPU scope markers
+// Every thread appends finished scopes to its own ring of CPU_TRACE_MAX_EVENTS events; only the
+// owning thread writes a ring and publishes with a release store of the head, so recording takes no
+// lock and the exporter can read while threads keep running. A full ring overwrites its oldest events
+// Disabled tracing costs one load and branch per scope; building with HT_NO_CPU_TRACE removes the
+// markers entirely. Scope names must outlive the trace, string literals are expected
+// --------------------------------------------------------------------------------------------------
+const unsigned int CPU_TRACE_MAX_EVENTS = 1 << 16;
+
+// Set by cpuTraceEnable(), read by every marker
+extern bool cpuTraceEnabled;
+
+// Starts recording, call once before the threads to trace start
+void cpuTraceEnable();
+
+// Names the calling thread in the exported trace, e.g. "worker 3"
+void cpuTraceSetThreadName(const char *name);
+
+// Appends a finished scope to the calling thread's ring
+void cpuTraceRecord(const char *name, long long begin, long long end);
+
+// Writes every recorded event as Chrome trace JSON (chrome://tracing, ui.perfetto.dev)
+void writeCpuTrace(std::ostream &out);
+
+// Timestamp in nanoseconds on the trace clock
+inline long long cpuTraceNow()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Records the time from construction to end() or destruction
+// -----------------------------------------------------------
+class CpuTraceScope
+{
+public:
+#ifdef HT_NO_CPU_TRACE
+	explicit CpuTraceScope(const char *) {}
+	void end() {}
+#else
+	explicit CpuTraceScope(const char *scopeName) : name(cpuTraceEnabled ? scopeName : NULL), begin(name ? cpuTraceNow() : 0) {}
+	~CpuTraceScope() { end(); }
+
+	// Closes the scope early, for phases that don't end with a block
+	void end()
+	{
+		if (name)
+			cpuTraceRecord(name, begin, cpuTraceNow());
+		name = NULL;
+	}
+
+private:
+	const char *name;
+	long long begin;
+#endif
+};
+
+#define CPU_TRACE_CONCAT_(a, b) a##b
+#define CPU_TRACE_CONCAT(a, b) CPU_TRACE_CONCAT_(a, b)
+// Traces the rest of the enclosing block
+#define CPU_TRACE_SCOPE(name) CpuTraceScope CPU_TRACE_CONCAT(cpuTraceScope, __LINE__)(name)
+
+#endif
@@ -0,0 +1,109 @@
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include "frame_pacing.h"
+
+#include <algorithm>
+#include <thread>
+
+int applySwapInterval(VsyncMode mode, bool benchmark)
+{
+	int interval = 1;
+	if (mode == VSYNC_OFF || (mode == VSYNC_DEFAULT && benchmark))
+		interval = 0;
+	else if (mode == VSYNC_ADAPTIVE && (glfwExtensionSupported("WGL_EXT_swap_control_tear")
+		|| glfwExtensionSupported("GLX_EXT_swap_control_tear")))
+		interval = -1;
+	glfwSwapInterval(interval);
+	return interval;
+}
+
+// Bounds of the learned sleep margin: below the lower one a sleep can't be trusted at all,
+// above the upper one the spin would burn more than it saves
+static const std::chrono::microseconds MIN_SLEEP_MARGIN(100);
+static const std::chrono::microseconds MAX_SLEEP_MARGIN(4000);
+
+void FramePacer::init(unsigned int maxFramesInFlight, unsigned int fpsCap)
+{
+	fences.assign(maxFramesInFlight, NULL);
+	frame = 0;
+	period = fpsCap ? std::chrono::duration_cast<Clock::duration>(std::chrono::nanoseconds(1000000000LL / fpsCap)) : Clock::duration::zero();
+	nextFrame = Clock::now();
+	started = false;
+	intervals.clear();
+}
+
+void FramePacer::destroy()
+{
+	for (size_t i = 0; i < fences.size(); i++)
+	{
+		if (fences[i])
+			glDeleteSync((GLsync)fences[i]);
+		fences[i] = NULL;
+	}
+}
+
+void FramePacer::waitForFrame()
+{
+	// Frame rate cap: sleep most of the way, spin the rest
+	if (period != Clock::duration::zero())
+	{
+		Clock::time_point now = Clock::now();
+		if (nextFrame - now > sleepMargin)
+		{
+			Clock::time_point wakeTarget = nextFrame - sleepMargin;
+			std::this_thread::sleep_until(wakeTarget);
+			Clock::time_point woke = Clock::now();
+			sleepMs += std::chrono::duration<double, std::milli>(woke - now).count();
+
+			// Grow the margin to the worst oversleep seen, shrink it slowly when sleeps are accurate
+			Clock::duration oversleep = woke - wakeTarget;
+			if (oversleep > sleepMargin)
+				sleepMargin = oversleep;
+			else
+				sleepMargin -= (sleepMargin - oversleep) / 64;
+			sleepMargin = std::min<Clock::duration>(std::max<Clock::duration>(sleepMargin, MIN_SLEEP_MARGIN), MAX_SLEEP_MARGIN);
+		}
+		Clock::time_point spinStart = Clock::now();
+		while (Clock::now() < nextFrame)
+			;
+		spinMs += std::chrono::duration<double, std::milli>(Clock::now() - spinStart).count();
+
+		// Keep the cadence, but don't try to make up for frames that ran long
+		nextFrame = std::max(nextFrame + period, Clock::now());
+	}
+
+	// Frames in flight: wait for the frame that used this slot last time
+	if (!fences.empty())
+	{
+		void *&fence = fences[frame % fences.size()];
+		if (fence)
+		{
+			GLenum result = glClientWaitSync((GLsync)fence, 0, 0);
+			if (result == GL_TIMEOUT_EXPIRED)
+			{
+				Clock::time_point waitStart = Clock::now();
+				fenceWaits++;
+				do
+					result = glClientWaitSync((GLsync)fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+				while (result == GL_TIMEOUT_EXPIRED);
+				fenceWaitMs += std::chrono::duration<double, std::milli>(Clock::now() - waitStart).count();
+			}
+			glDeleteSync((GLsync)fence);
+			fence = NULL;
+		}
+	}
+
+	Clock::time_point start = Clock::now();
+	if (started)
+		intervals.push_back(std::chrono::duration<double, std::milli>(start - lastStart).count());
+	lastStart = start;
+	started = true;
+}
+
+void FramePacer::frameSubmitted()
+{
+	if (!fences.empty())
+		fences[frame % fences.size()] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	frame++;
+}
@@ -0,0 +1,70 @@
+#ifndef FRAME_PACING_H
+#define FRAME_PACING_H
+
+#include <chrono>
+#include <vector>
+
+// Swap interval modes for --vsync
+enum VsyncMode
+{
+	// On for interactive runs, off for --benchmark
+	VSYNC_DEFAULT,
+	VSYNC_OFF,
+	VSYNC_ON,
+	// Sync when on time, tear instead of waiting a whole refresh when late (swap interval -1)
+	VSYNC_ADAPTIVE
+};
+
+// Sets the swap interval of the current GLFW context; adaptive falls back to on when the
+// *_EXT_swap_control_tear extension is missing. Returns the interval actually set
+int applySwapInterval(VsyncMode mode, bool benchmark);
+
+// Controls how far the CPU runs ahead of the GPU and how often frames start
+// With maxFramesInFlight N, a fence is inserted after every submitted frame and the start of a
+// frame waits for the fence from N frames before, so the CPU never queues more than N frames and
+// input is sampled at most N frames before it is shown. With a frame rate cap, the start of a frame
+// sleeps until its slot, waking early by a margin learned from how late sleeps return, then spins
+// to the exact time; a plain sleep alone overshoots by up to a scheduler tick
+// Call waitForFrame() before sampling input, so the waiting happens before the latency starts
+// -------------------------------------------------------------------------------------------------
+class FramePacer
+{
+public:
+	// 0 disables either limit
+	void init(unsigned int maxFramesInFlight, unsigned int fpsCap);
+	void destroy();
+
+	// Blocks until the frame may start, requires glad to be loaded when frames in flight are limited
+	void waitForFrame();
+
+	// Call once the frame is submitted (after the swap)
+	void frameSubmitted();
+
+	// Time between consecutive frame starts, in milliseconds
+	const std::vector<double> &getFrameIntervals() const { return intervals; }
+	unsigned int getFenceWaits() const { return fenceWaits; }
+	double getFenceWaitMs() const { return fenceWaitMs; }
+	double getSleepMs() const { return sleepMs; }
+	double getSpinMs() const { return spinMs; }
+
+private:
+	typedef std::chrono::steady_clock Clock;
+
+	std::vector<void *> fences;
+	unsigned int frame = 0;
+
+	Clock::duration period = Clock::duration::zero();
+	Clock::time_point nextFrame;
+	Clock::duration sleepMargin = std::chrono::milliseconds(1);
+
+	bool started = false;
+	Clock::time_point lastStart;
+	std::vector<double> intervals;
+
+	unsigned int fenceWaits = 0;
+	double fenceWaitMs = 0.0;
+	double sleepMs = 0.0;
+	double spinMs = 0.0;
+};
+
+#endif
@@ -0,0 +1,179 @@
+#include <glad/glad.h>
+
+#include "frame_stats.h"
+
+#include <algorithm>
+
+TimingSummary summarizeTimings(std::vector<double> samples)
+{
+	TimingSummary summary;
+	if (samples.empty())
+		return summary;
+
+	std::sort(samples.begin(), samples.end());
+	size_t count = samples.size();
+
+	double total = 0.0;
+	for (double sample : samples)
+		total += sample;
+
+	// Nearest-rank percentiles
+	size_t p99Rank = (size_t)((count * 99 + 99) / 100);
+	summary.min = samples.front();
+	summary.median = count % 2 ? samples[count / 2] : 0.5 * (samples[count / 2 - 1] + samples[count / 2]);
+	summary.p99 = samples[std::min(count, std::max<size_t>(p99Rank, 1)) - 1];
+	summary.max = samples.back();
+	summary.mean = total / count;
+	return summary;
+}
+
+FrameTimeHistogram buildHistogram(const std::vector<double> &samples, double bucketMs, unsigned int bucketCount)
+{
+	FrameTimeHistogram histogram;
+	histogram.bucketMs = bucketMs;
+	histogram.counts.assign(bucketCount, 0);
+	if (bucketCount == 0)
+		return histogram;
+	for (double sample : samples)
+	{
+		size_t bucket = sample > 0.0 ? (size_t)(sample / bucketMs) : 0;
+		histogram.counts[bucket < bucketCount ? bucket : bucketCount - 1]++;
+	}
+	return histogram;
+}
+
+void printHistogram(std::ostream &out, const FrameTimeHistogram &histogram)
+{
+	const unsigned int BAR_WIDTH = 50;
+	size_t first = 0;
+	size_t last = histogram.counts.size();
+	while (first < last && histogram.counts[first] == 0)
+		first++;
+	while (last > first && histogram.counts[last - 1] == 0)
+		last--;
+	unsigned int largest = 0;
+	for (size_t i = first; i < last; i++)
+		largest = std::max(largest, histogram.counts[i]);
+
+	for (size_t i = first; i < last; i++)
+	{
+		bool overflow = i + 1 == histogram.counts.size();
+		out << (overflow ? ">= " : "   ") << i * histogram.bucketMs << " ms\t" << histogram.counts[i] << "\t"
+			<< std::string((size_t)histogram.counts[i] * BAR_WIDTH / largest, '#') << "\n";
+	}
+	out.flush();
+}
+
+void FrameStats::init(unsigned int expectedFrames)
+{
+	glGenQueries(QUERY_RING_SIZE, queries);
+	cpuMs.reserve(expectedFrames);
+	gpuMs.reserve(expectedFrames);
+}
+
+void FrameStats::destroy()
+{
+	glDeleteQueries(QUERY_RING_SIZE, queries);
+	for (unsigned int i = 0; i < QUERY_RING_SIZE; i++)
+	{
+		queries[i] = 0;
+		pending[i] = false;
+	}
+}
+
+void FrameStats::beginFrame()
+{
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	if (started)
+		cpuMs.push_back(std::chrono::duration<double, std::milli>(now - lastFrameStart).count());
+	lastFrameStart = now;
+	started = true;
+}
+
+void FrameStats::beginGpu()
+{
+	// Reusing a slot means reading the query issued QUERY_RING_SIZE frames ago, which is long done
+	unsigned int slot = gpuFrame % QUERY_RING_SIZE;
+	if (pending[slot])
+		collectQuery(slot);
+	glBeginQuery(GL_TIME_ELAPSED, queries[slot]);
+}
+
+void FrameStats::endGpu()
+{
+	glEndQuery(GL_TIME_ELAPSED);
+	pending[gpuFrame % QUERY_RING_SIZE] = true;
+	gpuFrame++;
+}
+
+void FrameStats::finish()
+{
+	if (started)
+		cpuMs.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - lastFrameStart).count());
+	started = false;
+
+	// Drain in submission order so gpuMs stays in frame order
+	for (unsigned int i = 0; i < QUERY_RING_SIZE; i++)
+	{
+		unsigned int slot = (gpuFrame + i) % QUERY_RING_SIZE;
+		if (pending[slot])
+			collectQuery(slot);
+	}
+}
+
+void FrameStats::collectQuery(unsigned int slot)
+{
+	GLuint64 elapsed = 0;
+	glGetQueryObjectui64v(queries[slot], GL_QUERY_RESULT, &elapsed);
+	gpuMs.push_back(elapsed / 1.0e6);
+	pending[slot] = false;
+}
+
+void FrameStats::addCounter(const std::string &name, double value)
+{
+	counters.push_back(std::make_pair(name, value));
+}
+
+static void writeSummary(std::ostream &out, const char *name, const std::vector<double> &samples)
+{
+	TimingSummary summary = summarizeTimings(samples);
+	out << "  \"" << name << "\": { \"samples\": " << samples.size()
+		<< ", \"min\": " << summary.min
+		<< ", \"median\": " << summary.median
+		<< ", \"p99\": " << summary.p99
+		<< ", \"max\": " << summary.max
+		<< ", \"mean\": " << summary.mean << " }";
+}
+
+void FrameStats::writeJson(std::ostream &out) const
+{
+	out << "{\n";
+	out << "  \"frames\": " << cpuMs.size() << ",\n";
+	out << "  \"renderer\": \"" << renderer << "\",\n";
+
+	double totalMs = 0.0;
+	for (double sample : cpuMs)
+		totalMs += sample;
+	out << "  \"fps\": " << (totalMs > 0.0 ? cpuMs.size() * 1000.0 / totalMs : 0.0) << ",\n";
+	writeSummary(out, "cpu_frame_ms", cpuMs);
+	out << ",\n";
+	writeSummary(out, "gpu_draw_ms", gpuMs);
+
+	// 0.25 ms buckets up to 100 ms, trailing empty buckets left out
+	FrameTimeHistogram histogram = buildHistogram(cpuMs, 0.25, 400);
+	size_t used = histogram.counts.size();
+	while (used > 0 && histogram.counts[used - 1] == 0)
+		used--;
+	out << ",\n  \"cpu_frame_histogram\": { \"bucket_ms\": " << histogram.bucketMs << ", \"counts\": [";
+	for (size_t i = 0; i < used; i++)
+		out << (i ? ", " : "") << histogram.counts[i];
+	out << "] }";
+	if (!counters.empty())
+	{
+		out << ",\n  \"counters\": {";
+		for (size_t i = 0; i < counters.size(); i++)
+			out << (i ? ", " : " ") << "\"" << counters[i].first << "\": " << counters[i].second;
+		out << " }";
+	}
+	out << "\n}" << std::endl;
+}
@@ -0,0 +1,87 @@
+#ifndef FRAME_STATS_H
+#define FRAME_STATS_H
+
+#include <chrono>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Summary of a set of timings, all values in milliseconds
+// -------------------------------------------------------
+struct TimingSummary
+{
+	double min = 0.0;
+	double median = 0.0;
+	double p99 = 0.0;
+	double max = 0.0;
+	double mean = 0.0;
+};
+
+TimingSummary summarizeTimings(std::vector<double> samples);
+
+// Frame-time histogram with fixed-width buckets, the last bucket also counts everything slower
+// --------------------------------------------------------------------------------------------
+struct FrameTimeHistogram
+{
+	double bucketMs = 0.0;
+	std::vector<unsigned int> counts;
+};
+
+FrameTimeHistogram buildHistogram(const std::vector<double> &samples, double bucketMs, unsigned int bucketCount);
+
+// One line per bucket from the fastest to the slowest non-empty one, with a bar scaled to the largest
+void printHistogram(std::ostream &out, const FrameTimeHistogram &histogram);
+
+// Records CPU frame time and GPU time of the draw block for every frame
+// GL_TIME_ELAPSED queries are kept in a small ring and read back a few frames later,
+// so collecting the results never stalls the pipeline
+// ----------------------------------------------------------------------------------
+class FrameStats
+{
+public:
+	static const unsigned int QUERY_RING_SIZE = 4;
+
+	// Creates the query objects, requires glad to be loaded
+	void init(unsigned int expectedFrames);
+	void destroy();
+
+	// Call at the top of every iteration of the render loop
+	void beginFrame();
+
+	// Bracket the GPU work to time, queries of the same target can't nest
+	void beginGpu();
+	void endGpu();
+
+	// Waits for outstanding queries and records the last frame time
+	void finish();
+
+	// Renderer name reported in the JSON, e.g. GL_RENDERER
+	void setRenderer(const std::string &name) { renderer = name; }
+
+	// Extra named values (e.g. draws per frame) reported alongside the timings
+	void addCounter(const std::string &name, double value);
+
+	// Writes the benchmark results as a JSON object, including a histogram of the CPU frame times
+	void writeJson(std::ostream &out) const;
+
+	const std::vector<double> &cpuFrameTimes() const { return cpuMs; }
+	const std::vector<double> &gpuTimes() const { return gpuMs; }
+
+private:
+	void collectQuery(unsigned int slot);
+
+	unsigned int queries[QUERY_RING_SIZE] = {};
+	bool pending[QUERY_RING_SIZE] = {};
+	unsigned int gpuFrame = 0;
+
+	bool started = false;
+	std::chrono::steady_clock::time_point lastFrameStart;
+
+	std::vector<double> cpuMs;
+	std::vector<double> gpuMs;
+	std::vector<std::pair<std::string, double> > counters;
+	std::string renderer;
+};
+
+#endif
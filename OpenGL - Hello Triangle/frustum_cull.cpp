@@ -0,0 +1,223 @@
+#include "frustum_cull.h"
+
+#include <cmath>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FRUSTUM_CULL_SSE2
+#include <emmintrin.h>
+#endif
+
+void extractFrustum(const float viewProjection[16], Frustum &frustum)
+{
+	// Row i of the column-major matrix is m[i], m[4 + i], m[8 + i], m[12 + i]
+	// Each plane is the fourth row plus or minus one of the others: left, right, bottom, top, near, far
+	const float *m = viewProjection;
+	for (int plane = 0; plane < 6; plane++)
+	{
+		int row = plane / 2;
+		float sign = plane % 2 ? -1.0f : 1.0f;
+		float *p = frustum.planes[plane];
+		for (int column = 0; column < 4; column++)
+			p[column] = m[column * 4 + 3] + sign * m[column * 4 + row];
+		float length = std::sqrt(p[0] * p[0] + p[1] * p[1] + p[2] * p[2]);
+		if (length > 0.0f)
+			for (int column = 0; column < 4; column++)
+				p[column] /= length;
+	}
+}
+
+// CullBounds
+// ----------
+void CullBounds::resize(size_t newCount)
+{
+	count = newCount;
+	size_t padded = (count + CULL_BATCH_SIZE - 1) / CULL_BATCH_SIZE * CULL_BATCH_SIZE;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		center[axis].resize(padded, 0.0f);
+		extent[axis].resize(padded, 0.0f);
+	}
+	radius.resize(padded, 0.0f);
+}
+
+void CullBounds::setBox(size_t index, const float boxCenter[3], const float boxExtent[3])
+{
+	for (int axis = 0; axis < 3; axis++)
+	{
+		center[axis][index] = boxCenter[axis];
+		extent[axis][index] = boxExtent[axis];
+	}
+	radius[index] = std::sqrt(boxExtent[0] * boxExtent[0] + boxExtent[1] * boxExtent[1] + boxExtent[2] * boxExtent[2]);
+}
+
+void CullBounds::setSphere(size_t index, const float sphereCenter[3], float sphereRadius)
+{
+	for (int axis = 0; axis < 3; axis++)
+	{
+		center[axis][index] = sphereCenter[axis];
+		extent[axis][index] = sphereRadius;
+	}
+	radius[index] = sphereRadius;
+}
+
+// Culling
+// -------
+// An object is visible when, for every plane, the signed distance of its center is at least minus
+// its reach towards the plane: the radius for spheres, |a| * extent.x + |b| * extent.y + |c| * extent.z
+// for boxes. Every path evaluates the same expression in the same order; only an object exactly on a plane
+// can come out differently, where the compiler contracts the scalar multiply-adds into FMAs
+size_t cullFrustumScalar(const Frustum &frustum, const CullBounds &bounds, CullVolume volume,
+	size_t first, size_t last, unsigned int *visible)
+{
+	const float *cx = bounds.getCenter(0), *cy = bounds.getCenter(1), *cz = bounds.getCenter(2);
+	const float *ex = bounds.getExtent(0), *ey = bounds.getExtent(1), *ez = bounds.getExtent(2);
+	const float *r = bounds.getRadius();
+	size_t kept = 0;
+	for (size_t i = first; i < last; i++)
+	{
+		bool inside = true;
+		for (int plane = 0; plane < 6 && inside; plane++)
+		{
+			const float *p = frustum.planes[plane];
+			float distance = p[0] * cx[i] + p[1] * cy[i] + p[2] * cz[i] + p[3];
+			float reach = volume == CULL_SPHERES ? r[i]
+				: std::fabs(p[0]) * ex[i] + std::fabs(p[1]) * ey[i] + std::fabs(p[2]) * ez[i];
+			inside = distance >= -reach;
+		}
+		if (inside)
+			visible[kept++] = (unsigned int)i;
+	}
+	return kept;
+}
+
+#if defined(__AVX2__)
+// For each 8-bit visibility mask, the lanes that are set packed into 4-bit fields from the bottom
+// and how many there are, so a batch's visible indices are written with one store
+struct CompactTable
+{
+	unsigned int lanes[256];
+	unsigned char counts[256];
+
+	CompactTable()
+	{
+		for (unsigned int mask = 0; mask < 256; mask++)
+		{
+			unsigned int packed = 0, count = 0;
+			for (unsigned int lane = 0; lane < 8; lane++)
+				if (mask & (1u << lane))
+					packed |= lane << (4 * count++);
+			lanes[mask] = packed;
+			counts[mask] = (unsigned char)count;
+		}
+	}
+};
+
+static const CompactTable COMPACT_TABLE;
+
+size_t cullFrustum(const Frustum &frustum, const CullBounds &bounds, CullVolume volume,
+	size_t first, size_t last, unsigned int *visible)
+{
+	const float *cx = bounds.getCenter(0), *cy = bounds.getCenter(1), *cz = bounds.getCenter(2);
+	const float *ex = bounds.getExtent(0), *ey = bounds.getExtent(1), *ez = bounds.getExtent(2);
+	const float *r = bounds.getRadius();
+	const __m256 signMask = _mm256_set1_ps(-0.0f);
+	const __m256i fieldShifts = _mm256_setr_epi32(0, 4, 8, 12, 16, 20, 24, 28);
+	size_t kept = 0;
+	for (size_t i = first; i < last; i += CULL_BATCH_SIZE)
+	{
+		__m256 x = _mm256_loadu_ps(cx + i), y = _mm256_loadu_ps(cy + i), z = _mm256_loadu_ps(cz + i);
+		__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+		for (int plane = 0; plane < 6; plane++)
+		{
+			const float *p = frustum.planes[plane];
+			__m256 a = _mm256_set1_ps(p[0]), b = _mm256_set1_ps(p[1]), c = _mm256_set1_ps(p[2]);
+			__m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(a, x), _mm256_mul_ps(b, y)),
+				_mm256_mul_ps(c, z)), _mm256_set1_ps(p[3]));
+			__m256 reach;
+			if (volume == CULL_SPHERES)
+				reach = _mm256_loadu_ps(r + i);
+			else
+				reach = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_andnot_ps(signMask, a), _mm256_loadu_ps(ex + i)),
+					_mm256_mul_ps(_mm256_andnot_ps(signMask, b), _mm256_loadu_ps(ey + i))),
+					_mm256_mul_ps(_mm256_andnot_ps(signMask, c), _mm256_loadu_ps(ez + i)));
+			inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, _mm256_xor_ps(reach, signMask), _CMP_GE_OQ));
+		}
+
+		unsigned int mask = (unsigned int)_mm256_movemask_ps(inside);
+		if (last - i < CULL_BATCH_SIZE)
+			mask &= (1u << (last - i)) - 1;
+		// Index of each set lane, stored whole; the lanes past the count are overwritten by the next batch
+		__m256i lanes = _mm256_and_si256(_mm256_srlv_epi32(_mm256_set1_epi32((int)COMPACT_TABLE.lanes[mask]), fieldShifts),
+			_mm256_set1_epi32(7));
+		_mm256_storeu_si256((__m256i *)(visible + kept), _mm256_add_epi32(lanes, _mm256_set1_epi32((int)i)));
+		kept += COMPACT_TABLE.counts[mask];
+	}
+	return kept;
+}
+#elif defined(FRUSTUM_CULL_SSE2)
+// Two halves of 4 objects per batch
+size_t cullFrustum(const Frustum &frustum, const CullBounds &bounds, CullVolume volume,
+	size_t first, size_t last, unsigned int *visible)
+{
+	const float *cx = bounds.getCenter(0), *cy = bounds.getCenter(1), *cz = bounds.getCenter(2);
+	const float *ex = bounds.getExtent(0), *ey = bounds.getExtent(1), *ez = bounds.getExtent(2);
+	const float *r = bounds.getRadius();
+	const __m128 signMask = _mm_set1_ps(-0.0f);
+	size_t kept = 0;
+	for (size_t i = first; i < last; i += CULL_BATCH_SIZE)
+	{
+		unsigned int mask = 0;
+		for (size_t half = 0; half < CULL_BATCH_SIZE; half += 4)
+		{
+			size_t j = i + half;
+			__m128 x = _mm_loadu_ps(cx + j), y = _mm_loadu_ps(cy + j), z = _mm_loadu_ps(cz + j);
+			__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+			for (int plane = 0; plane < 6; plane++)
+			{
+				const float *p = frustum.planes[plane];
+				__m128 a = _mm_set1_ps(p[0]), b = _mm_set1_ps(p[1]), c = _mm_set1_ps(p[2]);
+				__m128 distance = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(a, x), _mm_mul_ps(b, y)),
+					_mm_mul_ps(c, z)), _mm_set1_ps(p[3]));
+				__m128 reach;
+				if (volume == CULL_SPHERES)
+					reach = _mm_loadu_ps(r + j);
+				else
+					reach = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_andnot_ps(signMask, a), _mm_loadu_ps(ex + j)),
+						_mm_mul_ps(_mm_andnot_ps(signMask, b), _mm_loadu_ps(ey + j))),
+						_mm_mul_ps(_mm_andnot_ps(signMask, c), _mm_loadu_ps(ez + j)));
+				inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, _mm_xor_ps(reach, signMask)));
+			}
+			mask |= (unsigned int)_mm_movemask_ps(inside) << half;
+		}
+
+		if (last - i < CULL_BATCH_SIZE)
+			mask &= (1u << (last - i)) - 1;
+		// Branch free: every lane is written and only the visible ones advance, visibility is too random to predict
+		for (unsigned int lane = 0; lane < CULL_BATCH_SIZE; lane++)
+		{
+			visible[kept] = (unsigned int)(i + lane);
+			kept += (mask >> lane) & 1;
+		}
+	}
+	return kept;
+}
+#else
+size_t cullFrustum(const Frustum &frustum, const CullBounds &bounds, CullVolume volume,
+	size_t first, size_t last, unsigned int *visible)
+{
+	return cullFrustumScalar(frustum, bounds, volume, first, last, visible);
+}
+#endif
+
+const char *cullSimdPath()
+{
+#if defined(__AVX2__)
+	return "AVX2";
+#elif defined(FRUSTUM_CULL_SSE2)
+	return "SSE2";
+#else
+	return "scalar";
+#endif
+}
@@ -0,0 +1,71 @@
+#ifndef FRUSTUM_CULL_H
+#define FRUSTUM_CULL_H
+
+#include <cstddef>
+#include <vector>
+
+// View frustum as six inward-facing planes (a, b, c, d), left, right, bottom, top, near, far
+// A point p is on the inner side of a plane when a * p.x + b * p.y + c * p.z + d >= 0
+// ------------------------------------------------------------------------------------------
+struct Frustum
+{
+	float planes[6][4];
+};
+
+// Planes of a column-major (OpenGL) view-projection matrix, after Gribb and Hartmann, normalized so
+// plane distances are in world units. The identity matrix gives the clip-space cube [-1, 1]^3
+void extractFrustum(const float viewProjection[16], Frustum &frustum);
+
+// Objects tested per iteration of the culling loop, the width of an AVX2 register of floats
+const unsigned int CULL_BATCH_SIZE = 8;
+
+enum CullVolume
+{
+	// Center distance against the radius: 4 multiply-adds per plane, conservative for boxes
+	CULL_SPHERES,
+	// Center distance against the box's projected extent: 7 multiply-adds per plane, exact
+	// for axis-aligned boxes against each plane (boxes straddling two planes outside a corner still pass)
+	CULL_BOXES
+};
+
+// Bounding volumes of many objects in structure-of-arrays layout
+// Every field is its own array, so a batch of CULL_BATCH_SIZE objects loads each field with a single
+// vector load. The arrays are padded to a multiple of CULL_BATCH_SIZE and the padding is never visible
+// -----------------------------------------------------------------------------------------------------
+class CullBounds
+{
+public:
+	void resize(size_t count);
+	size_t size() const { return count; }
+
+	// Axis-aligned box around center with half-size extent, its sphere is the one enclosing the box
+	void setBox(size_t index, const float center[3], const float extent[3]);
+	// Sphere, its box is the one enclosing the sphere
+	void setSphere(size_t index, const float center[3], float radius);
+
+	const float *getCenter(int axis) const { return center[axis].data(); }
+	const float *getExtent(int axis) const { return extent[axis].data(); }
+	const float *getRadius() const { return radius.data(); }
+
+private:
+	size_t count = 0;
+	std::vector<float> center[3];
+	std::vector<float> extent[3];
+	std::vector<float> radius;
+};
+
+// Writes the indices of the objects in [first, last) that intersect the frustum to visible, in
+// increasing order, and returns how many there are. first must be a multiple of CULL_BATCH_SIZE and
+// visible needs room for last - first rounded up to a multiple of CULL_BATCH_SIZE, as whole batches
+// of indices are stored at once. Ranges with different first can be culled on different threads
+size_t cullFrustum(const Frustum &frustum, const CullBounds &bounds, CullVolume volume,
+	size_t first, size_t last, unsigned int *visible);
+
+// One object at a time, the reference the SIMD paths must match
+size_t cullFrustumScalar(const Frustum &frustum, const CullBounds &bounds, CullVolume volume,
+	size_t first, size_t last, unsigned int *visible);
+
+// "AVX2", "SSE2" or "scalar", the path cullFrustum() was compiled with
+const char *cullSimdPath();
+
+#endif
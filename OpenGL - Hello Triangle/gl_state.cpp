@@ -0,0 +1,239 @@
+#include <glad/glad.h>
+
+#include "gl_state.h"
+
+GLStateCache glState;
+
+// Never a valid object name or enum, marks a value the cache doesn't know
+static const unsigned int UNKNOWN = 0xFFFFFFFFu;
+
+// Slot of a shadowed buffer binding point, -1 for targets that aren't tracked
+static int bufferSlot(unsigned int target)
+{
+	switch (target)
+	{
+	case GL_ARRAY_BUFFER: return 0;
+	case GL_ELEMENT_ARRAY_BUFFER: return 1;
+	case GL_PIXEL_PACK_BUFFER: return 2;
+	case GL_PIXEL_UNPACK_BUFFER: return 3;
+	case GL_UNIFORM_BUFFER: return 4;
+	case GL_COPY_READ_BUFFER: return 5;
+	case GL_COPY_WRITE_BUFFER: return 6;
+	case GL_DRAW_INDIRECT_BUFFER: return 7;
+	default: return -1;
+	}
+}
+
+static int textureSlot(unsigned int target)
+{
+	switch (target)
+	{
+	case GL_TEXTURE_2D: return 0;
+	case GL_TEXTURE_2D_ARRAY: return 1;
+	case GL_TEXTURE_3D: return 2;
+	case GL_TEXTURE_CUBE_MAP: return 3;
+	default: return -1;
+	}
+}
+
+static int capabilitySlot(unsigned int capability)
+{
+	switch (capability)
+	{
+	case GL_BLEND: return 0;
+	case GL_DEPTH_TEST: return 1;
+	case GL_CULL_FACE: return 2;
+	case GL_SCISSOR_TEST: return 3;
+	case GL_STENCIL_TEST: return 4;
+	case GL_FRAMEBUFFER_SRGB: return 5;
+	default: return -1;
+	}
+}
+
+void GLStateCache::invalidate()
+{
+	program = UNKNOWN;
+	vertexArray = UNKNOWN;
+	for (unsigned int i = 0; i < BUFFER_TARGET_COUNT; i++)
+		buffers[i] = UNKNOWN;
+	activeUnit = UNKNOWN;
+	for (unsigned int unit = 0; unit < MAX_TEXTURE_UNITS; unit++)
+		for (unsigned int i = 0; i < TEXTURE_TARGET_COUNT; i++)
+			textures[unit][i] = UNKNOWN;
+	for (unsigned int i = 0; i < CAPABILITY_COUNT; i++)
+		capabilities[i] = UNKNOWN;
+	blendSource = blendDestination = UNKNOWN;
+	depthFunction = UNKNOWN;
+	depthWrite = UNKNOWN;
+	clearColorKnown = false;
+}
+
+void GLStateCache::setFiltering(bool enabled)
+{
+	filtering = enabled;
+	invalidate();
+}
+
+bool GLStateCache::change(unsigned int &shadow, unsigned int value)
+{
+	bool changed = !filtering || shadow != value;
+	shadow = value;
+	count(changed);
+	return changed;
+}
+
+void GLStateCache::count(bool issued)
+{
+	if (issued)
+	{
+		frameCounters.issued++;
+		totalCounters.issued++;
+	}
+	else
+	{
+		frameCounters.elided++;
+		totalCounters.elided++;
+	}
+}
+
+void GLStateCache::useProgram(unsigned int value)
+{
+	if (change(program, value))
+		glUseProgram(value);
+}
+
+void GLStateCache::bindVertexArray(unsigned int value)
+{
+	if (change(vertexArray, value))
+	{
+		glBindVertexArray(value);
+		buffers[bufferSlot(GL_ELEMENT_ARRAY_BUFFER)] = UNKNOWN;
+	}
+}
+
+void GLStateCache::bindBuffer(unsigned int target, unsigned int buffer)
+{
+	int slot = bufferSlot(target);
+	if (slot < 0)
+	{
+		count(true);
+		glBindBuffer(target, buffer);
+	}
+	else if (change(buffers[slot], buffer))
+		glBindBuffer(target, buffer);
+}
+
+void GLStateCache::activeTexture(unsigned int unit)
+{
+	if (change(activeUnit, unit))
+		glActiveTexture(unit);
+}
+
+void GLStateCache::bindTexture(unsigned int target, unsigned int texture)
+{
+	int slot = textureSlot(target);
+	unsigned int unit = activeUnit - GL_TEXTURE0;
+	if (slot < 0 || activeUnit == UNKNOWN || unit >= MAX_TEXTURE_UNITS)
+	{
+		count(true);
+		glBindTexture(target, texture);
+	}
+	else if (change(textures[unit][slot], texture))
+		glBindTexture(target, texture);
+}
+
+void GLStateCache::setCapability(unsigned int capability, bool enabled)
+{
+	int slot = capabilitySlot(capability);
+	if (slot < 0)
+		count(true);
+	else if (!change(capabilities[slot], enabled ? 1 : 0))
+		return;
+
+	if (enabled)
+		glEnable(capability);
+	else
+		glDisable(capability);
+}
+
+void GLStateCache::enable(unsigned int capability)
+{
+	setCapability(capability, true);
+}
+
+void GLStateCache::disable(unsigned int capability)
+{
+	setCapability(capability, false);
+}
+
+void GLStateCache::blendFunc(unsigned int sourceFactor, unsigned int destinationFactor)
+{
+	bool changed = !filtering || blendSource != sourceFactor || blendDestination != destinationFactor;
+	blendSource = sourceFactor;
+	blendDestination = destinationFactor;
+	count(changed);
+	if (changed)
+		glBlendFunc(sourceFactor, destinationFactor);
+}
+
+void GLStateCache::depthFunc(unsigned int function)
+{
+	if (change(depthFunction, function))
+		glDepthFunc(function);
+}
+
+void GLStateCache::depthMask(bool write)
+{
+	if (change(depthWrite, write ? 1 : 0))
+		glDepthMask(write ? GL_TRUE : GL_FALSE);
+}
+
+void GLStateCache::clearColor(float red, float green, float blue, float alpha)
+{
+	bool changed = !filtering || !clearColorKnown || clearValue[0] != red || clearValue[1] != green
+		|| clearValue[2] != blue || clearValue[3] != alpha;
+	clearColorKnown = true;
+	clearValue[0] = red;
+	clearValue[1] = green;
+	clearValue[2] = blue;
+	clearValue[3] = alpha;
+	count(changed);
+	if (changed)
+		glClearColor(red, green, blue, alpha);
+}
+
+void GLStateCache::deleteVertexArrays(int n, const unsigned int *names)
+{
+	// Deleting the bound VAO reverts to VAO 0, whose element buffer binding we don't know
+	for (int i = 0; i < n; i++)
+		if (names[i] != 0 && names[i] == vertexArray)
+		{
+			vertexArray = 0;
+			buffers[bufferSlot(GL_ELEMENT_ARRAY_BUFFER)] = UNKNOWN;
+		}
+	glDeleteVertexArrays(n, names);
+}
+
+void GLStateCache::deleteBuffers(int n, const unsigned int *names)
+{
+	for (int i = 0; i < n; i++)
+		for (unsigned int slot = 0; slot < BUFFER_TARGET_COUNT; slot++)
+			if (names[i] != 0 && buffers[slot] == names[i])
+				buffers[slot] = 0;
+	glDeleteBuffers(n, names);
+}
+
+void GLStateCache::deleteTextures(int n, const unsigned int *names)
+{
+	for (int i = 0; i < n; i++)
+		for (unsigned int unit = 0; unit < MAX_TEXTURE_UNITS; unit++)
+			for (unsigned int slot = 0; slot < TEXTURE_TARGET_COUNT; slot++)
+				if (names[i] != 0 && textures[unit][slot] == names[i])
+					textures[unit][slot] = 0;
+	glDeleteTextures(n, names);
+}
+
+void GLStateCache::beginFrame()
+{
+	frameCounters = GLStateCounters();
+}
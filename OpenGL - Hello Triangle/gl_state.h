@@ -0,0 +1,93 @@
+#ifndef GL_STATE_H
+#define GL_STATE_H
+
+// Calls issued to the driver and calls skipped because the value was already set
+struct GLStateCounters
+{
+	unsigned long long issued = 0;
+	unsigned long long elided = 0;
+};
+
+// Shadow copy of the GL binding and fixed-function state the renderer touches
+// Every bind/enable/blend/depth/clear color change goes through here; a call setting the value already
+// current is dropped before it reaches the driver. Objects must be deleted through the cache as well,
+// GL unbinds deleted objects and a recycled name would otherwise look like it's still bound
+// The element array buffer binding belongs to the VAO, so it is forgotten whenever the VAO changes
+// Tracks the single context current on the render thread, see glState below
+// ----------------------------------------------------------------------------------------------------
+class GLStateCache
+{
+public:
+	static const unsigned int MAX_TEXTURE_UNITS = 16;
+
+	GLStateCache() { invalidate(); }
+
+	// Forgets every shadowed value, the next call of each kind always reaches the driver
+	// Call after the context is created and after code outside the cache changed state
+	void invalidate();
+
+	// With filtering off every call is forwarded, to measure what the cache saves; also invalidates
+	void setFiltering(bool enabled);
+	bool isFiltering() const { return filtering; }
+
+	void useProgram(unsigned int program);
+	void bindVertexArray(unsigned int vertexArray);
+	void bindBuffer(unsigned int target, unsigned int buffer);
+	// unit is the GL enum, e.g. GL_TEXTURE0
+	void activeTexture(unsigned int unit);
+	// Binds to the active texture unit
+	void bindTexture(unsigned int target, unsigned int texture);
+
+	void enable(unsigned int capability);
+	void disable(unsigned int capability);
+	void blendFunc(unsigned int sourceFactor, unsigned int destinationFactor);
+	void depthFunc(unsigned int function);
+	void depthMask(bool write);
+	void clearColor(float red, float green, float blue, float alpha);
+
+	// glDelete* wrappers that also drop the deleted names from the shadowed bindings
+	void deleteVertexArrays(int n, const unsigned int *names);
+	void deleteBuffers(int n, const unsigned int *names);
+	void deleteTextures(int n, const unsigned int *names);
+
+	// Call at the top of every frame, starts a new set of per-frame counters
+	void beginFrame();
+
+	// Counters of the frame in progress and of everything since the start
+	const GLStateCounters &getFrameCounters() const { return frameCounters; }
+	const GLStateCounters &getTotalCounters() const { return totalCounters; }
+
+private:
+	static const unsigned int BUFFER_TARGET_COUNT = 8;
+	static const unsigned int TEXTURE_TARGET_COUNT = 4;
+	static const unsigned int CAPABILITY_COUNT = 6;
+
+	// Returns true if value differs from the shadow (or filtering is off) and updates the shadow
+	bool change(unsigned int &shadow, unsigned int value);
+	void count(bool issued);
+	void setCapability(unsigned int capability, bool enabled);
+
+	bool filtering = true;
+
+	// Shadowed values, UNKNOWN until the first call sets them
+	unsigned int program;
+	unsigned int vertexArray;
+	unsigned int buffers[BUFFER_TARGET_COUNT];
+	unsigned int activeUnit;
+	unsigned int textures[MAX_TEXTURE_UNITS][TEXTURE_TARGET_COUNT];
+	unsigned int capabilities[CAPABILITY_COUNT];
+	unsigned int blendSource;
+	unsigned int blendDestination;
+	unsigned int depthFunction;
+	unsigned int depthWrite;
+	bool clearColorKnown;
+	float clearValue[4];
+
+	GLStateCounters frameCounters;
+	GLStateCounters totalCounters;
+};
+
+// State cache of the render thread's context
+extern GLStateCache glState;
+
+#endif
@@ -0,0 +1,212 @@
+#include <glad/glad.h>
+
+#include "gpu_profiler.h"
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+
+// Marks a scope on the open stack that didn't fit in the frame's queries
+static const unsigned int DROPPED_SCOPE = 0xFFFFFFFF;
+
+void GpuProfiler::init(unsigned int maxScopesPerFrame, bool keepTraceEvents)
+{
+	keepEvents = keepTraceEvents;
+	maxScopes = maxScopesPerFrame ? maxScopesPerFrame : 1;
+	for (unsigned int i = 0; i < FRAME_LATENCY; i++)
+	{
+		slots[i].queries.assign(maxScopes * 2, 0);
+		glGenQueries((GLsizei)slots[i].queries.size(), slots[i].queries.data());
+		slots[i].scopes.reserve(maxScopes);
+	}
+
+	// Pair up the two clocks, GL_TIMESTAMP read this way is the GPU time the command stream has reached
+	GLint64 gpuNow = 0;
+	glGetInteger64v(GL_TIMESTAMP, &gpuNow);
+	start = Clock::now();
+	gpuStart = gpuNow;
+}
+
+void GpuProfiler::destroy()
+{
+	for (unsigned int i = 0; i < FRAME_LATENCY; i++)
+	{
+		if (!slots[i].queries.empty())
+			glDeleteQueries((GLsizei)slots[i].queries.size(), slots[i].queries.data());
+		slots[i].queries.clear();
+		slots[i].scopes.clear();
+		slots[i].usedQueries = 0;
+		slots[i].pending = false;
+	}
+}
+
+void GpuProfiler::beginFrame()
+{
+	// The slot was last used FRAME_LATENCY frames ago, its results are normally in by now
+	Slot &slot = slots[frame % FRAME_LATENCY];
+	if (slot.pending)
+		collect(slot);
+	slot.scopes.clear();
+	slot.usedQueries = 0;
+	slot.frame = frame;
+	open.clear();
+	inFrame = true;
+}
+
+void GpuProfiler::endFrame()
+{
+	if (!inFrame)
+		return;
+	while (!open.empty())
+		pop();
+	Slot &slot = slots[frame % FRAME_LATENCY];
+	slot.pending = !slot.scopes.empty();
+	inFrame = false;
+	frame++;
+}
+
+void GpuProfiler::push(const char *name)
+{
+	if (!inFrame)
+		return;
+	Slot &slot = slots[frame % FRAME_LATENCY];
+	if (slot.usedQueries + 2 > slot.queries.size())
+	{
+		droppedScopes++;
+		open.push_back(DROPPED_SCOPE);
+		return;
+	}
+
+	Scope scope;
+	scope.name = name;
+	scope.depth = (unsigned int)open.size();
+	scope.beginQuery = slot.usedQueries++;
+	scope.endQuery = slot.usedQueries++;
+	scope.cpuBegin = Clock::now();
+	scope.cpuEnd = scope.cpuBegin;
+	glQueryCounter(slot.queries[scope.beginQuery], GL_TIMESTAMP);
+	open.push_back((unsigned int)slot.scopes.size());
+	slot.scopes.push_back(scope);
+}
+
+void GpuProfiler::pop()
+{
+	if (!inFrame || open.empty())
+		return;
+	unsigned int index = open.back();
+	open.pop_back();
+	if (index == DROPPED_SCOPE)
+		return;
+
+	Slot &slot = slots[frame % FRAME_LATENCY];
+	Scope &scope = slot.scopes[index];
+	glQueryCounter(slot.queries[scope.endQuery], GL_TIMESTAMP);
+	scope.cpuEnd = Clock::now();
+}
+
+void GpuProfiler::finish()
+{
+	if (inFrame)
+		endFrame();
+	// Oldest first, so events stay in frame order
+	for (unsigned int i = 0; i < FRAME_LATENCY; i++)
+	{
+		Slot &slot = slots[(frame + i) % FRAME_LATENCY];
+		if (slot.pending)
+			collect(slot);
+	}
+}
+
+void GpuProfiler::collect(Slot &slot)
+{
+	// Results become available in order, so the last query stands for all of them
+	GLint available = 0;
+	glGetQueryObjectiv(slot.queries[slot.usedQueries - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+	if (!available)
+		stalls++;
+
+	for (size_t i = 0; i < slot.scopes.size(); i++)
+	{
+		const Scope &scope = slot.scopes[i];
+		GLuint64 begin = 0;
+		GLuint64 end = 0;
+		glGetQueryObjectui64v(slot.queries[scope.beginQuery], GL_QUERY_RESULT, &begin);
+		glGetQueryObjectui64v(slot.queries[scope.endQuery], GL_QUERY_RESULT, &end);
+
+		Event event;
+		event.name = scope.name;
+		event.depth = scope.depth;
+		event.frame = slot.frame;
+		event.gpuBegin = ((long long)begin - gpuStart) / 1000.0;
+		event.gpuEnd = ((long long)end - gpuStart) / 1000.0;
+		event.cpuBegin = std::chrono::duration<double, std::micro>(scope.cpuBegin - start).count();
+		event.cpuEnd = std::chrono::duration<double, std::micro>(scope.cpuEnd - start).count();
+		if (keepEvents)
+			events.push_back(event);
+
+		double gpuMs = (event.gpuEnd - event.gpuBegin) / 1000.0;
+		double cpuMs = (event.cpuEnd - event.cpuBegin) / 1000.0;
+		size_t s = 0;
+		while (s < stats.size() && std::strcmp(stats[s].name, scope.name) != 0)
+			s++;
+		if (s == stats.size())
+		{
+			GpuScopeStats entry;
+			entry.name = scope.name;
+			entry.depth = scope.depth;
+			entry.gpuMinMs = gpuMs;
+			entry.gpuMaxMs = gpuMs;
+			stats.push_back(entry);
+		}
+		GpuScopeStats &entry = stats[s];
+		entry.calls++;
+		entry.gpuTotalMs += gpuMs;
+		entry.gpuMinMs = std::min(entry.gpuMinMs, gpuMs);
+		entry.gpuMaxMs = std::max(entry.gpuMaxMs, gpuMs);
+		entry.cpuTotalMs += cpuMs;
+	}
+	collectedFrames++;
+	slot.pending = false;
+}
+
+void GpuProfiler::printStats(std::ostream &out) const
+{
+	out << "GPU scopes over " << collectedFrames << " frames (mean per call, GPU / CPU):\n";
+	for (size_t i = 0; i < stats.size(); i++)
+	{
+		const GpuScopeStats &entry = stats[i];
+		out << "  " << std::string(entry.depth * 2, ' ') << entry.name << ": " << entry.gpuTotalMs / entry.calls << " ms / "
+			<< entry.cpuTotalMs / entry.calls << " ms (min " << entry.gpuMinMs << ", max " << entry.gpuMaxMs << ", "
+			<< entry.calls << " calls)\n";
+	}
+	if (droppedScopes || stalls)
+		out << "  " << droppedScopes << " scopes dropped, " << stalls << " stalled readbacks\n";
+	out.flush();
+}
+
+static void writeTraceEvent(std::ostream &out, const char *name, const char *category, unsigned int thread,
+	unsigned int frame, double begin, double end)
+{
+	out << ",\n{ \"name\": \"" << name << "\", \"cat\": \"" << category << "\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << thread
+		<< ", \"ts\": " << begin << ", \"dur\": " << std::max(end - begin, 0.0) << ", \"args\": { \"frame\": " << frame << " } }";
+}
+
+void GpuProfiler::writeChromeTrace(std::ostream &out) const
+{
+	std::streamsize precision = out.precision(3);
+	std::ios::fmtflags flags = out.setf(std::ios::fixed, std::ios::floatfield);
+
+	out << "{ \"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+	out << "{ \"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": 1, \"args\": { \"name\": \"CPU (GL thread)\" } },\n";
+	out << "{ \"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": 2, \"args\": { \"name\": \"GPU\" } }";
+	for (size_t i = 0; i < events.size(); i++)
+	{
+		const Event &event = events[i];
+		writeTraceEvent(out, event.name, "cpu", 1, event.frame, event.cpuBegin, event.cpuEnd);
+		writeTraceEvent(out, event.name, "gpu", 2, event.frame, event.gpuBegin, event.gpuEnd);
+	}
+	out << "\n] }" << std::endl;
+
+	out.precision(precision);
+	out.flags(flags);
+}
@@ -0,0 +1,137 @@
+#ifndef GPU_PROFILER_H
+#define GPU_PROFILER_H
+
+#include <chrono>
+#include <ostream>
+#include <vector>
+
+// Accumulated GPU and CPU time of every scope with the same name, in milliseconds
+// -------------------------------------------------------------------------------
+struct GpuScopeStats
+{
+	const char *name = NULL;
+	unsigned int depth = 0;
+	unsigned int calls = 0;
+	double gpuTotalMs = 0.0;
+	double gpuMinMs = 0.0;
+	double gpuMaxMs = 0.0;
+	double cpuTotalMs = 0.0;
+};
+
+// Scoped GPU profiler
+// Every scope writes a GL_TIMESTAMP query when it opens and when it closes, so unlike
+// GL_TIME_ELAPSED (see FrameStats) scopes can nest. Queries of a frame live in one slot of a ring of
+// FRAME_LATENCY slots and are read when the slot comes around again, by then the GPU is long done
+// with them and reading never stalls. The CPU time of each scope is recorded next to it, and both
+// can be written as a Chrome trace (chrome://tracing, ui.perfetto.dev) with a CPU and a GPU track
+// GPU timestamps are moved to the CPU clock with an offset measured once at init()
+// Scope names must outlive the profiler, string literals are expected
+// --------------------------------------------------------------------------------------------------
+class GpuProfiler
+{
+public:
+	static const unsigned int FRAME_LATENCY = 4;
+
+	// Creates the query objects, requires glad to be loaded
+	// Trace events are only kept with keepEvents, the per-scope stats always are
+	void init(unsigned int maxScopesPerFrame, bool keepEvents);
+	void destroy();
+
+	// Bracket every frame; scopes opened outside of a frame are ignored
+	void beginFrame();
+	void endFrame();
+
+	void push(const char *name);
+	void pop();
+
+	// Reads every outstanding query, call once rendering is done
+	void finish();
+
+	// Per-scope totals in the order the scopes first appeared
+	const std::vector<GpuScopeStats> &getStats() const { return stats; }
+	unsigned int getFrames() const { return collectedFrames; }
+	// Scopes dropped because a frame opened more than maxScopesPerFrame
+	unsigned int getDroppedScopes() const { return droppedScopes; }
+	// Slots that were read before their results were available, each one a pipeline stall
+	unsigned int getStalls() const { return stalls; }
+
+	// One line per scope, indented by nesting depth
+	void printStats(std::ostream &out) const;
+	// Chrome trace event JSON of every collected scope
+	void writeChromeTrace(std::ostream &out) const;
+
+private:
+	typedef std::chrono::steady_clock Clock;
+
+	struct Scope
+	{
+		const char *name;
+		unsigned int depth;
+		unsigned int beginQuery;
+		unsigned int endQuery;
+		Clock::time_point cpuBegin;
+		Clock::time_point cpuEnd;
+	};
+
+	struct Slot
+	{
+		std::vector<unsigned int> queries;
+		std::vector<Scope> scopes;
+		unsigned int usedQueries = 0;
+		unsigned int frame = 0;
+		bool pending = false;
+	};
+
+	// Trace event, times in microseconds since init()
+	struct Event
+	{
+		const char *name;
+		unsigned int depth;
+		unsigned int frame;
+		double gpuBegin;
+		double gpuEnd;
+		double cpuBegin;
+		double cpuEnd;
+	};
+
+	void collect(Slot &slot);
+
+	Slot slots[FRAME_LATENCY];
+	unsigned int maxScopes = 0;
+	bool keepEvents = false;
+	unsigned int frame = 0;
+	bool inFrame = false;
+	std::vector<unsigned int> open;
+
+	Clock::time_point start;
+	// GPU timestamp in nanoseconds that corresponds to start
+	long long gpuStart = 0;
+
+	std::vector<GpuScopeStats> stats;
+	std::vector<Event> events;
+	unsigned int collectedFrames = 0;
+	unsigned int droppedScopes = 0;
+	unsigned int stalls = 0;
+};
+
+// Opens a scope for the lifetime of the object, profiler may be NULL
+// -------------------------------------------------------------------
+class GpuScope
+{
+public:
+	GpuScope(GpuProfiler *profiler, const char *name) : profiler(profiler)
+	{
+		if (profiler)
+			profiler->push(name);
+	}
+	~GpuScope()
+	{
+		if (profiler)
+			profiler->pop();
+	}
+
+private:
+	GpuProfiler *profiler;
+};
+
+#endif
@@ -0,0 +1,174 @@
+#include "headless.h"
+
+#include <iostream>
+
+#if defined(__linux__)
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+#if defined(__linux__)
+
+bool createHeadlessContext(HeadlessContext &headless)
+{
+	// Prefer Mesa's surfaceless platform, it needs neither an X server nor a GPU
+	EGLDisplay display = EGL_NO_DISPLAY;
+	PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+		(PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+	if (getPlatformDisplay)
+		display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+	if (display == EGL_NO_DISPLAY)
+		display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+	EGLint major, minor;
+	if (display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor))
+	{
+		std::cout << "ERROR::HEADLESS::EGL_INITIALIZE_FAILED" << std::endl;
+		return false;
+	}
+
+	if (!eglBindAPI(EGL_OPENGL_API))
+	{
+		std::cout << "ERROR::HEADLESS::EGL_BIND_API_FAILED" << std::endl;
+		eglTerminate(display);
+		return false;
+	}
+
+	// No surface is ever created, the config only has to support desktop OpenGL. The surface type
+	// defaults to EGL_WINDOW_BIT, which no config on the surfaceless platform has, so ask for pbuffers
+	const EGLint configAttribs[] = {
+		EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+		EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+		EGL_NONE
+	};
+	EGLConfig config;
+	EGLint numConfigs = 0;
+	if (!eglChooseConfig(display, configAttribs, &config, 1, &numConfigs) || numConfigs == 0)
+	{
+		std::cout << "ERROR::HEADLESS::EGL_NO_CONFIG" << std::endl;
+		eglTerminate(display);
+		return false;
+	}
+
+	const EGLint contextAttribs[] = {
+		EGL_CONTEXT_MAJOR_VERSION, 3,
+		EGL_CONTEXT_MINOR_VERSION, 3,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+		EGL_NONE
+	};
+	EGLContext context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttribs);
+	if (context == EGL_NO_CONTEXT)
+	{
+		std::cout << "ERROR::HEADLESS::EGL_CREATE_CONTEXT_FAILED" << std::endl;
+		eglTerminate(display);
+		return false;
+	}
+
+	// Requires EGL_KHR_surfaceless_context, rendering goes to the FBO instead
+	if (!eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context))
+	{
+		std::cout << "ERROR::HEADLESS::EGL_MAKE_CURRENT_FAILED" << std::endl;
+		eglDestroyContext(display, context);
+		eglTerminate(display);
+		return false;
+	}
+
+	headless.display = display;
+	headless.context = context;
+	return true;
+}
+
+void *headlessGetProcAddress(const char *name)
+{
+	return (void *)eglGetProcAddress(name);
+}
+
+static void destroyPlatformContext(HeadlessContext &headless)
+{
+	if (headless.display)
+	{
+		eglMakeCurrent(headless.display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+		if (headless.context)
+			eglDestroyContext(headless.display, headless.context);
+		eglTerminate(headless.display);
+	}
+	headless.display = NULL;
+	headless.context = NULL;
+}
+
+#else
+
+bool createHeadlessContext(HeadlessContext &headless)
+{
+	if (!glfwInit())
+	{
+		std::cout << "ERROR::HEADLESS::GLFW_INIT_FAILED" << std::endl;
+		return false;
+	}
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+	headless.hiddenWindow = glfwCreateWindow(1, 1, "OpenGL - Headless", NULL, NULL);
+	if (headless.hiddenWindow == NULL)
+	{
+		std::cout << "ERROR::HEADLESS::GLFW_CREATE_WINDOW_FAILED" << std::endl;
+		glfwTerminate();
+		return false;
+	}
+	glfwMakeContextCurrent(headless.hiddenWindow);
+	return true;
+}
+
+void *headlessGetProcAddress(const char *name)
+{
+	return (void *)glfwGetProcAddress(name);
+}
+
+static void destroyPlatformContext(HeadlessContext &headless)
+{
+	if (headless.hiddenWindow)
+	{
+		glfwDestroyWindow(headless.hiddenWindow);
+		glfwTerminate();
+	}
+	headless.hiddenWindow = NULL;
+}
+
+#endif
+
+bool createOffscreenTarget(HeadlessContext &headless, unsigned int width, unsigned int height)
+{
+	glGenFramebuffers(1, &headless.FBO);
+	glGenRenderbuffers(1, &headless.colorRBO);
+
+	glBindRenderbuffer(GL_RENDERBUFFER, headless.colorRBO);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, headless.FBO);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, headless.colorRBO);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+	{
+		std::cout << "ERROR::HEADLESS::FRAMEBUFFER_INCOMPLETE" << std::endl;
+		return false;
+	}
+
+	headless.width = width;
+	headless.height = height;
+	glViewport(0, 0, width, height);
+	return true;
+}
+
+void destroyHeadlessContext(HeadlessContext &headless)
+{
+	if (headless.FBO)
+	{
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		glDeleteFramebuffers(1, &headless.FBO);
+		glDeleteRenderbuffers(1, &headless.colorRBO);
+	}
+	headless.FBO = 0;
+	headless.colorRBO = 0;
+	destroyPlatformContext(headless);
+}
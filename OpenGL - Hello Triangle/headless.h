@@ -0,0 +1,35 @@
+#ifndef HEADLESS_H
+#define HEADLESS_H
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+// Offscreen OpenGL context rendering into a framebuffer object
+// On Linux this is an EGL surfaceless context, so it runs on GPU-less machines through Mesa (llvmpipe)
+// Elsewhere it falls back to an invisible GLFW window
+// -------------------------------------------------------------------------------------------------
+struct HeadlessContext
+{
+	void *display = NULL;
+	void *context = NULL;
+	GLFWwindow *hiddenWindow = NULL;
+
+	unsigned int FBO = 0;
+	unsigned int colorRBO = 0;
+	unsigned int width = 0;
+	unsigned int height = 0;
+};
+
+// Creates a core 3.3 context and makes it current on the calling thread
+bool createHeadlessContext(HeadlessContext &headless);
+
+// Loader to pass to gladLoadGLLoader for the current headless context
+void *headlessGetProcAddress(const char *name);
+
+// Creates and binds the framebuffer object everything is rendered into, requires glad to be loaded
+bool createOffscreenTarget(HeadlessContext &headless, unsigned int width, unsigned int height);
+
+// Releases the framebuffer object and the context
+void destroyHeadlessContext(HeadlessContext &headless);
+
+#endif
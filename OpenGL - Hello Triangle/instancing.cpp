@@ -0,0 +1,116 @@
+#include <glad/glad.h>
+
+#include "gl_state.h"
+#include "instancing.h"
+
+#include <cmath>
+#include <cstddef>
+
+void setDefaultInstanceAttributes()
+{
+	glVertexAttrib3f(INSTANCE_OFFSET_SCALE_LOCATION, 0.0f, 0.0f, 1.0f);
+	glVertexAttrib4f(INSTANCE_COLOR_LOCATION, 1.0f, 0.5f, 0.2f, 1.0f);
+}
+
+void generateInstanceGrid(unsigned int count, std::vector<InstanceData> &instances)
+{
+	instances.resize(count);
+	if (count == 0)
+		return;
+
+	// The unit quad spans [-0.5, 0.5], so scale by 80% of a cell and center it in the cell
+	unsigned int columns = (unsigned int)std::ceil(std::sqrt((double)count));
+	float cell = 2.0f / columns;
+	for (unsigned int i = 0; i < count; i++)
+	{
+		unsigned int column = i % columns;
+		unsigned int row = i / columns;
+		InstanceData &instance = instances[i];
+		instance.offset[0] = -1.0f + (column + 0.5f) * cell;
+		instance.offset[1] = -1.0f + (row + 0.5f) * cell;
+		instance.scale = cell * 0.8f;
+		instance.color[0] = (float)column / columns;
+		instance.color[1] = 0.5f;
+		instance.color[2] = (float)row / columns;
+		instance.color[3] = 1.0f;
+	}
+}
+
+void animateInstance(const InstanceData &base, float time, InstanceData &animated)
+{
+	float phase = (base.offset[0] + base.offset[1]) * 8.0f;
+	float radius = base.scale * 0.25f;
+	animated = base;
+	animated.offset[0] += std::cos(time * 2.0f + phase) * radius + std::sin(time * 0.5f) * 0.5f;
+	animated.offset[1] += std::sin(time * 2.0f + phase) * radius;
+}
+
+bool isInstanceVisible(const InstanceData &instance)
+{
+	float extent = instance.scale * 0.5f;
+	return std::fabs(instance.offset[0]) - extent < 1.0f && std::fabs(instance.offset[1]) - extent < 1.0f;
+}
+
+void InstancedRenderer::init(unsigned int meshVBO, unsigned int meshEBO, MeshVertexFormat meshFormat, unsigned int maxInstances)
+{
+	capacity = maxInstances;
+
+	glGenVertexArrays(1, &VAO);
+	glGenBuffers(1, &instanceVBO);
+	glState.bindVertexArray(VAO);
+
+	// Per-vertex position, same layout as the plain VAO
+	glState.bindBuffer(GL_ARRAY_BUFFER, meshVBO);
+	setupPositionAttribute(meshFormat);
+	glState.bindBuffer(GL_ELEMENT_ARRAY_BUFFER, meshEBO);
+
+	// Per-instance offset/scale and color, advancing once per instance
+	// upload() refills it every frame, so it is allocated for streaming
+	glState.bindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+	glBufferData(GL_ARRAY_BUFFER, capacity * sizeof(InstanceData), NULL, GL_STREAM_DRAW);
+	glVertexAttribPointer(INSTANCE_OFFSET_SCALE_LOCATION, 3, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (void*)offsetof(InstanceData, offset));
+	glEnableVertexAttribArray(INSTANCE_OFFSET_SCALE_LOCATION);
+	glVertexAttribDivisor(INSTANCE_OFFSET_SCALE_LOCATION, 1);
+	glVertexAttribPointer(INSTANCE_COLOR_LOCATION, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (void*)offsetof(InstanceData, color));
+	glEnableVertexAttribArray(INSTANCE_COLOR_LOCATION);
+	glVertexAttribDivisor(INSTANCE_COLOR_LOCATION, 1);
+
+	glState.bindVertexArray(0);
+}
+
+void InstancedRenderer::destroy()
+{
+	glState.deleteVertexArrays(1, &VAO);
+	glState.deleteBuffers(1, &instanceVBO);
+	VAO = instanceVBO = 0;
+	capacity = 0;
+}
+
+void InstancedRenderer::upload(const std::vector<InstanceData> &instances)
+{
+	size_t count = instances.size() < capacity ? instances.size() : capacity;
+	glState.bindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, count * sizeof(InstanceData), instances.data());
+}
+
+void InstancedRenderer::draw(unsigned int program, unsigned int indexCount, unsigned int indexType, unsigned int count)
+{
+	glState.useProgram(program);
+	glState.bindVertexArray(VAO);
+	glDrawElementsInstanced(GL_TRIANGLES, indexCount, indexType, 0, count < capacity ? count : capacity);
+}
+
+void InstancedRenderer::drawPerObject(unsigned int program, unsigned int meshVAO, unsigned int indexCount, unsigned int indexType,
+	const std::vector<InstanceData> &instances)
+{
+	glState.useProgram(program);
+	glState.bindVertexArray(meshVAO);
+	for (size_t i = 0; i < instances.size(); i++)
+	{
+		const InstanceData &instance = instances[i];
+		glVertexAttrib3f(INSTANCE_OFFSET_SCALE_LOCATION, instance.offset[0], instance.offset[1], instance.scale);
+		glVertexAttrib4fv(INSTANCE_COLOR_LOCATION, instance.color);
+		glDrawElements(GL_TRIANGLES, indexCount, indexType, 0);
+	}
+	setDefaultInstanceAttributes();
+}
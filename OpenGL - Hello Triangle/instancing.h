@@ -0,0 +1,62 @@
+#ifndef INSTANCING_H
+#define INSTANCING_H
+
+#include "vertex_format.h"
+
+#include <vector>
+
+// Per-instance attributes, matching locations 1 and 2 of vertexShaderSource
+// -------------------------------------------------------------------------
+struct InstanceData
+{
+	float offset[2];
+	float scale;
+	float color[4];
+};
+
+// Vertex attribute locations of the per-instance data
+const unsigned int INSTANCE_OFFSET_SCALE_LOCATION = 1;
+const unsigned int INSTANCE_COLOR_LOCATION = 2;
+
+// Sets the generic values attributes 1 and 2 take when no instance buffer is bound:
+// no offset, unit scale and the original orange, so non-instanced draws look as before
+void setDefaultInstanceAttributes();
+
+// Fills instances with count quads laid out on a square grid covering the viewport
+void generateInstanceGrid(unsigned int count, std::vector<InstanceData> &instances);
+
+// Moves a grid instance for the given time in seconds: each quad circles its cell while the
+// whole grid sways sideways, pushing columns past the edges of the viewport
+void animateInstance(const InstanceData &base, float time, InstanceData &animated);
+
+// False when the unit quad scaled and offset by the instance lies entirely outside clip space
+bool isInstanceVisible(const InstanceData &instance);
+
+// Draws copies of an indexed mesh with glDrawElementsInstanced
+// The mesh's vertex and element buffers are shared through a second VAO that adds the instance buffer
+// ----------------------------------------------------------------------------------------------------
+class InstancedRenderer
+{
+public:
+	// Creates the VAO and instance buffer, requires glad to be loaded
+	void init(unsigned int meshVBO, unsigned int meshEBO, MeshVertexFormat meshFormat, unsigned int maxInstances);
+	void destroy();
+
+	// Replaces the contents of the instance buffer
+	void upload(const std::vector<InstanceData> &instances);
+
+	// Draws the first count uploaded instances with one call
+	void draw(unsigned int program, unsigned int indexCount, unsigned int indexType, unsigned int count);
+
+	// Reference path: one glDrawElements per instance with the attributes set as generic values
+	// meshVAO is the plain (non-instanced) VAO of the same mesh
+	static void drawPerObject(unsigned int program, unsigned int meshVAO, unsigned int indexCount, unsigned int indexType,
+		const std::vector<InstanceData> &instances);
+
+private:
+	unsigned int VAO = 0;
+	unsigned int instanceVBO = 0;
+	unsigned int capacity = 0;
+};
+
+#endif
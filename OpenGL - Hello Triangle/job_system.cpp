@@ -0,0 +1,174 @@
+#include "job_system.h"
+
+#include "cpu_trace.h"
+
+#include <algorithm>
+#include <string>
+
+// Index of the worker the current thread is, set by init() and workerLoop()
+static thread_local unsigned int currentWorker = 0;
+
+void JobSystem::init(unsigned int threadCount)
+{
+	shutdown();
+	unsigned int count = threadCount ? threadCount : std::max(1u, std::thread::hardware_concurrency());
+
+	workers.resize(count);
+	for (unsigned int i = 0; i < count; i++)
+	{
+		workers[i].reset(new Worker());
+		workers[i]->jobs = std::vector<Job>(MAX_JOBS_PER_WORKER);
+	}
+
+	stopping = false;
+	queued = 0;
+	currentWorker = 0;
+	for (unsigned int i = 1; i < count; i++)
+		threads.push_back(std::thread(&JobSystem::workerLoop, this, i));
+}
+
+void JobSystem::shutdown()
+{
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+		stopping = true;
+	}
+	wake.notify_all();
+	for (size_t i = 0; i < threads.size(); i++)
+		threads[i].join();
+	threads.clear();
+	workers.clear();
+}
+
+JobSystem::Job *JobSystem::create(const std::function<void()> &function, Job *parent)
+{
+	Worker &worker = *workers[currentWorker];
+	Job *job = &worker.jobs[worker.nextJob++ % MAX_JOBS_PER_WORKER];
+	job->function = function;
+	job->parent = parent;
+	job->unfinished.store(1, std::memory_order_relaxed);
+	if (parent)
+		parent->unfinished.fetch_add(1, std::memory_order_relaxed);
+	return job;
+}
+
+void JobSystem::run(Job *job)
+{
+	Worker &worker = *workers[currentWorker];
+	{
+		std::lock_guard<std::mutex> lock(worker.mutex);
+		worker.queue.push_back(job);
+	}
+	// Taking the sleep mutex orders the increment against a worker checking before it sleeps
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+		queued++;
+	}
+	wake.notify_one();
+}
+
+JobSystem::Job *JobSystem::pop(unsigned int index)
+{
+	Worker &worker = *workers[index];
+	std::lock_guard<std::mutex> lock(worker.mutex);
+	if (worker.queue.empty())
+		return NULL;
+	Job *job = worker.queue.back();
+	worker.queue.pop_back();
+	queued--;
+	return job;
+}
+
+JobSystem::Job *JobSystem::steal(unsigned int thief)
+{
+	for (size_t offset = 1; offset < workers.size(); offset++)
+	{
+		Worker &victim = *workers[(thief + offset) % workers.size()];
+		std::lock_guard<std::mutex> lock(victim.mutex);
+		if (!victim.queue.empty())
+		{
+			Job *job = victim.queue.front();
+			victim.queue.pop_front();
+			queued--;
+			return job;
+		}
+	}
+	return NULL;
+}
+
+void JobSystem::execute(Job *job)
+{
+	CPU_TRACE_SCOPE("job");
+	job->function();
+	finish(job);
+}
+
+void JobSystem::finish(Job *job)
+{
+	// Read before the decrement, a waiter may reuse the job as soon as the count reaches zero
+	Job *parent = job->parent;
+	if (job->unfinished.fetch_sub(1, std::memory_order_acq_rel) == 1 && parent)
+		finish(parent);
+}
+
+void JobSystem::wait(Job *job)
+{
+	unsigned int worker = currentWorker;
+	while (!isFinished(job))
+	{
+		Job *next = pop(worker);
+		if (!next)
+			next = steal(worker);
+		if (next)
+			execute(next);
+		else
+			std::this_thread::yield();
+	}
+}
+
+void JobSystem::workerLoop(unsigned int worker)
+{
+	currentWorker = worker;
+	std::string name = "worker " + std::to_string(worker);
+	cpuTraceSetThreadName(name.c_str());
+	for (;;)
+	{
+		Job *job = pop(worker);
+		if (!job)
+			job = steal(worker);
+		if (job)
+		{
+			execute(job);
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(sleepMutex);
+		wake.wait(lock, [this]() { return stopping || queued > 0; });
+		if (stopping)
+			return;
+	}
+}
+
+void JobSystem::parallelFor(size_t count, size_t grain, const std::function<void(size_t first, size_t last)> &function)
+{
+	if (count == 0)
+		return;
+	grain = std::max<size_t>(grain, 1);
+	if (workers.size() == 1 || count <= grain)
+	{
+		function(0, count);
+		return;
+	}
+
+	// At most a few chunks per worker, enough to balance without flooding the deques
+	size_t chunkCount = std::min((count + grain - 1) / grain, (size_t)workers.size() * 4);
+	Job *root = create([]() {});
+	for (size_t chunk = 0; chunk < chunkCount; chunk++)
+	{
+		size_t first = count * chunk / chunkCount;
+		size_t last = count * (chunk + 1) / chunkCount;
+		run(create([&function, first, last]() { function(first, last); }, root));
+	}
+	run(root);
+	wait(root);
+}
@@ -0,0 +1,85 @@
+#ifndef JOB_SYSTEM_H
+#define JOB_SYSTEM_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work-stealing task scheduler
+// Every worker owns a deque: it pushes and pops its own jobs at the back (newest first, still hot
+// in cache) while idle workers steal from the front of the others'. The thread calling init() is
+// worker 0 and runs jobs while it waits, so init(1) executes everything inline
+// A job counts as finished once it and all its children have run; waiting on a parent therefore
+// waits for the whole tree. Jobs come from a per-worker ring of MAX_JOBS_PER_WORKER entries that is
+// reused without freeing, so a worker may not have more than that many jobs alive at once
+// Only worker threads may create, run or wait on jobs
+// -------------------------------------------------------------------------------------------------
+class JobSystem
+{
+public:
+	static const unsigned int MAX_JOBS_PER_WORKER = 4096;
+
+	struct Job
+	{
+		std::function<void()> function;
+		Job *parent;
+		// 1 for the job itself plus one per unfinished child
+		std::atomic<int> unfinished;
+	};
+
+	~JobSystem() { shutdown(); }
+
+	// threadCount == 0 uses every hardware thread, including the calling one
+	void init(unsigned int threadCount);
+	void shutdown();
+
+	unsigned int getThreadCount() const { return (unsigned int)workers.size(); }
+
+	// Creates a job; with a parent, the parent doesn't finish before this job has. Run the children
+	// before the parent is waited on
+	Job *create(const std::function<void()> &function, Job *parent = NULL);
+
+	// Queues the job on the calling worker's deque
+	void run(Job *job);
+
+	// Executes queued jobs until job and its children have finished
+	void wait(Job *job);
+	bool isFinished(const Job *job) const { return job->unfinished.load(std::memory_order_acquire) == 0; }
+
+	// Calls function(first, last) over [0, count) in parallel and returns once all chunks are done
+	// grain is the minimum number of items per chunk; there are at most 4 chunks per worker, so
+	// chunks are usually larger. Ranges of at most grain items run on the calling thread
+	void parallelFor(size_t count, size_t grain, const std::function<void(size_t first, size_t last)> &function);
+
+private:
+	struct Worker
+	{
+		std::mutex mutex;
+		std::deque<Job *> queue;
+		std::vector<Job> jobs;
+		unsigned int nextJob = 0;
+	};
+
+	Job *pop(unsigned int worker);
+	Job *steal(unsigned int worker);
+	void execute(Job *job);
+	void finish(Job *job);
+	void workerLoop(unsigned int worker);
+
+	std::vector<std::unique_ptr<Worker> > workers;
+	std::vector<std::thread> threads;
+
+	// Sleeping workers wake up when queued jobs appear or on shutdown
+	std::mutex sleepMutex;
+	std::condition_variable wake;
+	std::atomic<int> queued{ 0 };
+	std::atomic<bool> stopping{ false };
+};
+
+#endif
@@ -1,184 +1,1097 @@
-#include <glad\glad.h>
-#include <GLFW\glfw3.h>
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
 
+#include "bvh.h"
+#include "command_buffer.h"
+#include "cpu_trace.h"
+#include "frame_pacing.h"
+#include "frame_stats.h"
+#include "frustum_cull.h"
+#include "gl_state.h"
+#include "gpu_profiler.h"
+#include "headless.h"
+#include "instancing.h"
+#include "job_system.h"
+#include "mesh.h"
+#include "mesh_import.h"
+#include "mesh_optimize.h"
+#include "options.h"
+#include "program_cache.h"
+#include "quad_batch.h"
+#include "readback.h"
+#include "render_queue.h"
+#include "shader.h"
+#include "soft_raster.h"
+#include "timestep.h"
+#include "vertex_format.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
 #include <iostream>
+#include <vector>
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
+void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods);
+void mouse_button_callback(GLFWwindow* window, int button, int action, int mods);
+void cursor_position_callback(GLFWwindow* window, double x, double y);
 void processInput(GLFWwindow *window);
+void submitQuadGrid(QuadBatch &batch, unsigned int count, unsigned int materialA, unsigned int materialB);
+
+// Culling state of the animated grid, kept across frames
+// ------------------------------------------------------
+struct GridCulling
+{
+	// Clip space, the shader has no camera
+	Frustum frustum;
+	// Object-space box of the mesh, moved and scaled like each instance
+	float meshMin[3];
+	float meshMax[3];
+	CullBounds bounds;
+	std::vector<unsigned int> visibleIndices;
+
+	// --bvh: the tree is refitted every frame and rebuilt once it costs BVH_REBUILD_RATIO times as much
+	// as when it was built; instances are animated into animated[] as the tree returns them out of order
+	bool useBvh = false;
+	Bvh bvh;
+	std::vector<InstanceData> animated;
+	unsigned int bvhBuilds = 0;
+	unsigned long long bvhVisited = 0;
+};
+
+const float BVH_REBUILD_RATIO = 1.5f;
+
+void animateGrid(JobSystem &jobs, const std::vector<InstanceData> &grid, float time, GridCulling &culling,
+	std::vector<InstanceData> &visible);
+int runSoftwareRenderer(const Options &options);
+int checkCapture(const Options &options, const Image &image);
 
 const unsigned int SCR_WIDTH = 800;
 const unsigned int SCR_HEIGHT = 600;
 
 // Defines vertex and fragment shader source code
 // ---------------------------------------------
+// aOffsetScale and aColor come from the instance buffer when drawing instanced,
+// otherwise from the generic values set by setDefaultInstanceAttributes()
+// aPositionScale and aPositionOffset dequantize aPos, see vertex_format.h
 const char *vertexShaderSource = "#version 330 core\n"
 "layout (location = 0) in vec3 aPos;\n"
+"layout (location = 1) in vec3 aOffsetScale;\n"
+"layout (location = 2) in vec4 aColor;\n"
+"layout (location = 3) in vec3 aPositionScale;\n"
+"layout (location = 4) in vec3 aPositionOffset;\n"
+"out vec4 vColor;\n"
 "void main()\n"
 "{\n"
-"   gl_Position = vec4(aPos.x, aPos.y, aPos.z, 1.0);\n"
+"   vec3 position = aPos * aPositionScale + aPositionOffset;\n"
+"   gl_Position = vec4(position.xy * aOffsetScale.z + aOffsetScale.xy, position.z, 1.0);\n"
+"   vColor = aColor;\n"
 "}\0";
 
 const char *fragmentShaderSource = "#version 330 core\n"
+"in vec4 vColor;\n"
 "out vec4 FragColor;\n"
 "void main()\n"
 "{\n"
-"   FragColor = vec4(1.0f, 0.5f, 0.2f, 1.0f);\n"
+"   FragColor = vColor;\n"
 "}\n\0";
 
-int main() {
+// Set vertex data and indices
+// ---------------------------
+const float vertices[] = {
+	0.5f,  0.5f, 0.0f,
+	0.5f, -0.5f, 0.0f,
+	-0.5f, -0.5f, 0.0f,
+	-0.5f,  0.5f, 0.0f
+};
 
-	// Initialize and configure glfw
-	// -----------------------------
-	glfwInit();
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-
-	// Create glfw window
-	// ------------------
-	GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "OpenGL - Creating a window", NULL, NULL);
-	// Check for window creation errors
-	if (window == NULL)
-	{
-		std::cout << "Failed to create GLFW Window" << std::endl;
-		glfwTerminate();
+const unsigned int indices[] = {
+	0, 2, 3,
+	0, 1, 2
+};
+
+// Flat grey shown while the real program is still being compiled
+// ---------------------------------------------------------------
+const char *fallbackFragmentShaderSource = "#version 330 core\n"
+"out vec4 FragColor;\n"
+"void main()\n"
+"{\n"
+"   FragColor = vec4(0.5f, 0.5f, 0.5f, 1.0f);\n"
+"}\n\0";
+
+int main(int argc, char *argv[]) {
+
+	std::chrono::steady_clock::time_point startupStart = std::chrono::steady_clock::now();
+
+	// Parse command line options
+	// --------------------------
+	Options options;
+	if (!parseOptions(argc, argv, options))
 		return -1;
+	if (!options.cpuTracePath.empty())
+		cpuTraceEnable();
+
+	// Render on the CPU, no GL context is needed
+	// -----------------------------------------
+	if (options.software)
+		return runSoftwareRenderer(options);
+
+	GLFWwindow* window = NULL;
+	HeadlessContext headless;
+	// Headless contexts never present, so they have no swap interval
+	int swapInterval = 0;
+	if (options.headless)
+	{
+		// Create an offscreen context instead of a window
+		// -----------------------------------------------
+		CPU_TRACE_SCOPE("create headless context");
+		if (!createHeadlessContext(headless))
+		{
+			std::cout << "Failed to create headless context" << std::endl;
+			return -1;
+		}
 	}
+	else
+	{
+		// Initialize and configure glfw
+		// -----------------------------
+		CpuTraceScope initScope("glfwInit");
+		glfwInit();
+		initScope.end();
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+		glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+
+		// Create glfw window
+		// ------------------
+		CpuTraceScope windowScope("glfwCreateWindow");
+		window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "OpenGL - Creating a window", NULL, NULL);
+		// Check for window creation errors
+		if (window == NULL)
+		{
+			std::cout << "Failed to create GLFW Window" << std::endl;
+			glfwTerminate();
+			return -1;
+		}
 
-	// Set the window be the current context
-	// -------------------------------------
-	glfwMakeContextCurrent(window);
+		// Set the window be the current context
+		// -------------------------------------
+		glfwMakeContextCurrent(window);
+		windowScope.end();
 
-	// Set function called on window resize
-	// ------------------------------------
-	glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+		// Set function called on window resize
+		// ------------------------------------
+		glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+
+		// Benchmarks measure rendering, not the display's refresh rate, unless --vsync says otherwise
+		swapInterval = applySwapInterval(options.vsync, options.benchmark);
+		if (options.vsync == VSYNC_ADAPTIVE && swapInterval != -1)
+			std::cout << "Adaptive vsync not supported, using vsync on" << std::endl;
+	}
 
 	// Load glad OpenGL function pointers
 	// ----------------------------------
-	if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+	GLADloadproc loader = options.headless ? (GLADloadproc)headlessGetProcAddress : (GLADloadproc)glfwGetProcAddress;
+	CpuTraceScope gladScope("gladLoadGLLoader");
+	if (!gladLoadGLLoader(loader))
 	{
 		std::cout << "Failed to initialize GLAD" << std::endl;
 		return -1;
 	}
+	gladScope.end();
 
+	// Headless rendering goes into a framebuffer object sized like the window would be
+	// --------------------------------------------------------------------------------
+	if (options.headless && !createOffscreenTarget(headless, SCR_WIDTH, SCR_HEIGHT))
+	{
+		destroyHeadlessContext(headless);
+		return -1;
+	}
 
-	// Build and compile vertex shader
-	// -------------------------------
-	// Vertex shader
-	unsigned int vertexShader;
-	vertexShader = glCreateShader(GL_VERTEX_SHADER);
-	glShaderSource(vertexShader, 1, &vertexShaderSource, NULL);
-	glCompileShader(vertexShader);
-	// Check for vertex shader compile errors
-	int success;
-	char infoLog[512];
-	glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &success);
-	if (!success)
-	{
-		glGetShaderInfoLog(vertexShader, 512, NULL, infoLog);
-		std::cout << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n" << infoLog << std::endl;
-	}
-
-	// Build and compile fragment shader
-	// ---------------------------------
-	// Vertex shader
-	unsigned int fragmentShader;
-	fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-	glShaderSource(fragmentShader, 1, &fragmentShaderSource, NULL);
-	glCompileShader(fragmentShader);
-	// Check for fragment shader compile errors
-	glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &success);
-	if (!success)
-	{
-		glGetShaderInfoLog(vertexShader, 512, NULL, infoLog);
-		std::cout << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n"<< infoLog << std::endl;
-	}
-
-	// Link shaders
-	// ------------
-	// Create shader program
-	unsigned int shaderProgram;
-	shaderProgram = glCreateProgram();
-	// Attach vertex and fragment shaders to shader program
-	glAttachShader(shaderProgram, vertexShader);
-	glAttachShader(shaderProgram, fragmentShader);
-	// Links attached shader programs into single final shader program
-	glLinkProgram(shaderProgram);
-	// Check for linking errors
-	glGetProgramiv(shaderProgram, GL_LINK_STATUS, &success);
-	if (!success) {
-		glGetProgramInfoLog(shaderProgram, 512, NULL, infoLog);
-		std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
-	}
-	glDeleteShader(vertexShader);
-	glDeleteShader(fragmentShader);
-
-	// Set vertex data and indices
-	// ---------------------------
-	float vertices[] = {
-		0.5f,  0.5f, 0.0f,
-		0.5f, -0.5f, 0.0f,
-		-0.5f, -0.5f, 0.0f,
-		-0.5f,  0.5f, 0.0f
-	};
+	// Every bind and state change from here on is filtered through the state cache
+	// ----------------------------------------------------------------------------
+	glState.setFiltering(options.stateCache);
 
-	unsigned int indices[] = {
-		0, 2, 3,
-		0, 1, 2
-	};
+	// Submit shader program builds
+	// ----------------------------
+	// Both programs compile in the background; frames draw with the fallback until the real program is ready
+	ProgramCache programCache;
+	if (options.shaderCache)
+		programCache.init(options.shaderCacheDirectory);
+	ShaderPipeline shaderPipeline;
+	shaderPipeline.init(&programCache);
+	unsigned int fallbackBuild = shaderPipeline.submit(vertexShaderSource, fallbackFragmentShaderSource);
+	unsigned int programBuild = shaderPipeline.submit(vertexShaderSource, fragmentShaderSource);
+	programCache.report();
+	unsigned int shaderProgram = 0;
+	unsigned int fallbackProgram = 0;
+	bool programBuildDone = false;
+	// Benchmarks time the steady state, not the compile, and captures must not depend on how fast it is
+	if (options.benchmark || options.wantsCapture())
+	{
+		shaderPipeline.finishAll();
+		shaderProgram = shaderPipeline.getProgram(programBuild);
+		fallbackProgram = shaderPipeline.getProgram(fallbackBuild);
+		programBuildDone = true;
+	}
 
+	CpuTraceScope uploadScope("buffer upload");
 	unsigned int VAO, VBO, EBO;
 	glGenVertexArrays(1, &VAO);
 	glGenBuffers(1, &VBO);
 	glGenBuffers(1, &EBO);
 	// Bind the Vertex Array Object first
-	glBindVertexArray(VAO);
+	glState.bindVertexArray(VAO);
 
-	glBindBuffer(GL_ARRAY_BUFFER, VBO);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+	unsigned int indexCount = sizeof(indices) / sizeof(indices[0]);
+	unsigned int vertexCount = sizeof(vertices) / (3 * sizeof(float));
+	float meshMin[3], meshMax[3];
+	MeshVertexFormat vertexFormat = options.vertexFormat;
+	PositionQuantization quantization;
+	std::vector<unsigned char> quantizedVertices;
+	unsigned int indexSize = chooseIndexSize(vertexCount);
+	std::vector<unsigned char> packedIndices;
+	std::string meshExtension = options.meshPath.substr(options.meshPath.find_last_of('.') + 1);
+	if (meshExtension == "obj" || meshExtension == "ply")
+	{
+		// OBJ and PLY are parsed on every core first, convert them once to skip this
+		JobSystem importJobs;
+		importJobs.init(options.threads);
+		ImportedMesh mesh;
+		if (!importMesh(options.meshPath, &importJobs, mesh))
+			return -1;
+		optimizeMesh(mesh.indices, mesh.positions);
+		vertexCount = mesh.getVertexCount();
+		computeBounds(mesh.positions.data(), vertexCount, meshMin, meshMax);
+		quantization = computeQuantization(vertexFormat, meshMin, meshMax);
+		quantizePositions(vertexFormat, quantization, mesh.positions.data(), vertexCount, quantizedVertices);
+		glState.bindBuffer(GL_ARRAY_BUFFER, VBO);
+		glBufferData(GL_ARRAY_BUFFER, quantizedVertices.size(), quantizedVertices.data(), GL_STATIC_DRAW);
+		indexSize = chooseIndexSize(vertexCount);
+		packIndices(mesh.indices.data(), mesh.indices.size(), indexSize, packedIndices);
+		glState.bindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, packedIndices.size(), packedIndices.data(), GL_STATIC_DRAW);
+		indexCount = mesh.getIndexCount();
+		std::cout << "Mesh " << options.meshPath << ": " << mesh.getVertexCount() << " vertices, "
+			<< indexCount / 3 << " triangles (imported)" << std::endl;
+	}
+	else if (!options.meshPath.empty())
+	{
+		// Uploaded straight from the file mapping, which can go as soon as glBufferData has copied it
+		MappedFile meshFile;
+		MeshView mesh;
+		if (!meshFile.open(options.meshPath))
+		{
+			std::cout << "ERROR::MESH::CANNOT_OPEN " << options.meshPath << std::endl;
+			return -1;
+		}
+		if (!openMesh(meshFile, mesh))
+			return -1;
+		// Stored quantized already, --vertex-format doesn't apply
+		uploadMesh(mesh, VBO, EBO);
+		indexCount = mesh.header->indexCount;
+		vertexCount = mesh.header->vertexCount;
+		indexSize = mesh.header->indexSize;
+		vertexFormat = (MeshVertexFormat)mesh.header->vertexFormat;
+		quantization = getMeshQuantization(mesh);
+		std::copy(mesh.header->boundsMin, mesh.header->boundsMin + 3, meshMin);
+		std::copy(mesh.header->boundsMax, mesh.header->boundsMax + 3, meshMax);
+		std::cout << "Mesh " << options.meshPath << ": " << vertexCount << " vertices (" << getVertexFormatName(vertexFormat)
+			<< "), " << indexCount / 3 << " triangles" << std::endl;
+	}
+	else
+	{
+		computeBounds(vertices, vertexCount, meshMin, meshMax);
+		quantization = computeQuantization(vertexFormat, meshMin, meshMax);
+		quantizePositions(vertexFormat, quantization, vertices, vertexCount, quantizedVertices);
+		glState.bindBuffer(GL_ARRAY_BUFFER, VBO);
+		glBufferData(GL_ARRAY_BUFFER, quantizedVertices.size(), quantizedVertices.data(), GL_STATIC_DRAW);
 
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+		packIndices(indices, indexCount, indexSize, packedIndices);
+		glState.bindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, packedIndices.size(), packedIndices.data(), GL_STATIC_DRAW);
+	}
+	unsigned int indexType = getIndexType(indexSize);
 
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
-	glEnableVertexAttribArray(0);
+	setupPositionAttribute(vertexFormat);
+	setDefaultInstanceAttributes();
+	// Generic attribute values are context state, so this holds for every VAO drawing the mesh
+	setPositionDequantization(quantization);
+	uploadScope.end();
 
 	// Render in wireframe
 	//glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
 
+	// Quad batcher used by --quads
+	// ----------------------------
+	QuadBatch quadBatch;
+	unsigned long long batchedDraws = 0;
+	if (options.quads)
+		quadBatch.init(options.batchSize, options.quads);
+
+	// Job system for per-frame CPU work: animation, culling, buffer preparation and command recording
+	// ------------------------------------------------------------------------------------------------
+	JobSystem jobSystem;
+	if (options.animate || options.parallelRecord)
+		jobSystem.init(options.threads);
+	std::vector<InstanceData> visibleInstances;
+	unsigned long long visibleTotal = 0;
+	GridCulling gridCulling;
+	gridCulling.useBvh = options.bvh;
+	bool pickButtonDown = false;
+	const float identity[16] = { 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f };
+	extractFrustum(identity, gridCulling.frustum);
+	std::copy(meshMin, meshMin + 3, gridCulling.meshMin);
+	std::copy(meshMax, meshMax + 3, gridCulling.meshMax);
+
+	// Instanced rendering used by --instances
+	// ---------------------------------------
+	InstancedRenderer instancedRenderer;
+	std::vector<InstanceData> instances;
+	if (options.instances)
+	{
+		generateInstanceGrid(options.instances, instances);
+		instancedRenderer.init(VBO, EBO, vertexFormat, options.instances);
+		instancedRenderer.upload(instances);
+	}
+
+	// Render queue used by --queue
+	// -----------------------------
+	RenderQueue renderQueue;
+	std::vector<InstanceData> queueGrid;
+	RenderQueueStats queueChanges;
+	ParallelRecorder recorder;
+	unsigned long long recordedBytes = 0;
+	if (options.queueItems)
+	{
+		generateInstanceGrid(options.queueItems, queueGrid);
+		renderQueue.reserve(options.queueItems);
+		renderQueue.setSorting(options.sortQueue);
+		if (options.parallelRecord)
+			recorder.init(jobSystem);
+	}
+
+	// Framebuffer readback for --capture, --golden and --readback-all
+	// ---------------------------------------------------------------
+	AsyncReadback readback;
+	Image captured;
+	if (options.wantsCapture())
+		readback.init();
+
+	// Frame timing for benchmark mode
+	// -------------------------------
+	FrameStats frameStats;
+	if (options.benchmark)
+	{
+		frameStats.init(options.frames);
+		frameStats.setRenderer((const char *)glGetString(GL_RENDERER));
+	}
+
+	// GPU profiler for --gpu-profile, scopes are no-ops without it
+	// -----------------------------------------------------------
+	GpuProfiler gpuProfiler;
+	GpuProfiler *profiler = NULL;
+	if (options.gpuProfile)
+	{
+		gpuProfiler.init(64, !options.gpuTracePath.empty());
+		profiler = &gpuProfiler;
+	}
+
+	// Frame pacing: frames in flight and frame rate cap
+	// -------------------------------------------------
+	FramePacer pacer;
+	pacer.init(options.maxFramesInFlight, options.fpsCap);
+
+	// Fixed-rate simulation and input latency tracking
+	// ------------------------------------------------
+	FixedTimestep timestep;
+	timestep.init(options.simulationHz);
+	InputLatency inputLatency;
+	if (window)
+	{
+		// Input callbacks only timestamp events, processInput still reads the keys
+		glfwSetWindowUserPointer(window, &inputLatency);
+		glfwSetKeyCallback(window, key_callback);
+		glfwSetMouseButtonCallback(window, mouse_button_callback);
+		glfwSetCursorPosCallback(window, cursor_position_callback);
+	}
+
 	// Render loop
 	// -----------
-	while (!glfwWindowShouldClose(window))
+	unsigned int frame = 0;
+	std::chrono::steady_clock::time_point loopStart = std::chrono::steady_clock::now();
+	std::chrono::steady_clock::time_point lastFrameTime = loopStart;
+	while (options.headless || !glfwWindowShouldClose(window))
 	{
-		// input
-		// -----
-		processInput(window);
+		// Stop once the requested number of frames has been rendered
+		if (options.frames != 0 && frame == options.frames)
+			break;
+		frame++;
+		CPU_TRACE_SCOPE("frame");
+
+		// Wait for a free frame slot before sampling any input
+		CpuTraceScope paceScope("pace");
+		pacer.waitForFrame();
+		paceScope.end();
+		glState.beginFrame();
+		if (options.benchmark)
+			frameStats.beginFrame();
+
+		// Input and simulation
+		// --------------------
+		// Time is spent in fixed steps of 1/--sim-hz, each polling input first, so the simulation rate
+		// doesn't follow the frame rate. Headless frames advance a fixed 1/60 s of virtual time so
+		// captured frames are reproducible, with one synthetic input per frame to measure latency
+		CpuTraceScope inputScope("input");
+		std::chrono::steady_clock::time_point frameTime = std::chrono::steady_clock::now();
+		long long elapsed = options.headless ? FixedTimestep::NANOSECONDS_PER_SECOND / 60
+			: std::chrono::duration_cast<std::chrono::nanoseconds>(frameTime - lastFrameTime).count();
+		lastFrameTime = frameTime;
+		if (options.headless)
+			inputLatency.onInput();
+		unsigned int steps = timestep.advance(elapsed);
+		for (unsigned int step = 0; step < steps; step++)
+		{
+			if (window)
+			{
+				glfwPollEvents();
+				processInput(window);
+			}
+			inputLatency.consumeInput();
+		}
+		inputScope.end();
+
+		// Animate the grid at the interpolated simulation time
+		// ----------------------------------------------------
+		const std::vector<InstanceData> &grid = options.instances ? instances : queueGrid;
+		const std::vector<InstanceData> *frameInstances = &grid;
+		if (options.animate)
+		{
+			CPU_TRACE_SCOPE("animate");
+			animateGrid(jobSystem, grid, (float)timestep.getInterpolatedTime(), gridCulling, visibleInstances);
+			frameInstances = &visibleInstances;
+			visibleTotal += visibleInstances.size();
+
+			// Pick the instance under the cursor on click: the shader has no camera, so the ray starts on the
+			// near plane of clip space and runs straight along +z
+			bool buttonDown = window && glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS;
+			if (options.bvh && buttonDown && !pickButtonDown)
+			{
+				double cursorX, cursorY;
+				int width, height;
+				glfwGetCursorPos(window, &cursorX, &cursorY);
+				glfwGetWindowSize(window, &width, &height);
+				float origin[3] = { (float)(cursorX / width * 2.0 - 1.0), (float)(1.0 - cursorY / height * 2.0), -1.0f };
+				float direction[3] = { 0.0f, 0.0f, 1.0f };
+				float distance;
+				int picked = gridCulling.bvh.raycast(origin, direction, gridCulling.bounds, distance);
+				if (picked >= 0)
+					std::cout << "Picked instance " << picked << " (" << gridCulling.bvh.getVisitedNodes() << " nodes visited)" << std::endl;
+				else
+					std::cout << "Picked nothing" << std::endl;
+			}
+			pickButtonDown = buttonDown;
+			if (options.instances && !options.perObject)
+				instancedRenderer.upload(visibleInstances);
+		}
 
 		// Render
 		// ------
-		glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
-		glClear(GL_COLOR_BUFFER_BIT);
+		CpuTraceScope renderScope("render");
+		if (options.benchmark)
+			frameStats.beginGpu();
+		if (profiler)
+		{
+			profiler->beginFrame();
+			profiler->push("frame");
+		}
+
+		{
+			GpuScope scope(profiler, "clear");
+			glState.clearColor(0.2f, 0.3f, 0.3f, 1.0f);
+			glClear(GL_COLOR_BUFFER_BIT);
+		}
 
 		// Draw triangles
-		glUseProgram(shaderProgram);
-		glBindVertexArray(VAO);
-		glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+		if (profiler)
+			profiler->push("draw");
+		unsigned int activeProgram = shaderProgram ? shaderProgram : fallbackProgram;
+		if (activeProgram && options.instances)
+		{
+			// One call for every instance, or the per-object loop it replaces for comparison
+			if (options.perObject)
+				InstancedRenderer::drawPerObject(activeProgram, VAO, indexCount, indexType, *frameInstances);
+			else
+				instancedRenderer.draw(activeProgram, indexCount, indexType, (unsigned int)frameInstances->size());
+		}
+		else if (activeProgram && options.quads)
+		{
+			// Alternate two materials once both programs exist, the batcher draws each with one call
+			quadBatch.begin();
+			submitQuadGrid(quadBatch, options.quads, activeProgram, fallbackProgram ? fallbackProgram : activeProgram);
+			quadBatch.end();
+			batchedDraws += quadBatch.getStats().draws;
+		}
+		else if (activeProgram && options.queueItems)
+		{
+			// Materials alternate in grid order, the worst case for unsorted submission
+			unsigned int otherProgram = fallbackProgram ? fallbackProgram : activeProgram;
+			renderQueue.clear();
+			for (size_t i = 0; i < frameInstances->size(); i++)
+			{
+				DrawItem item;
+				item.program = i % 2 ? otherProgram : activeProgram;
+				item.vertexArray = VAO;
+				item.indexCount = indexCount;
+				item.indexSize = indexSize;
+				item.instance = (*frameInstances)[i];
+				renderQueue.push(item);
+			}
+			renderQueue.sort();
+			if (options.parallelRecord)
+			{
+				// Each worker records a contiguous slice of the sorted items, the GL thread replays them in order
+				recorder.record([&](unsigned int worker, CommandBuffer &buffer) {
+					size_t workers = recorder.getThreadCount();
+					renderQueue.record(buffer, renderQueue.size() * worker / workers, renderQueue.size() * (worker + 1) / workers);
+				});
+				recorder.execute();
+				setDefaultInstanceAttributes();
+				recordedBytes += recorder.getBytesUsed();
+			}
+			else
+				renderQueue.submit();
+			RenderQueueStats changes = renderQueue.countStateChanges();
+			queueChanges.programChanges += changes.programChanges;
+		}
+		else if (activeProgram)
+		{
+			glState.useProgram(activeProgram);
+			glState.bindVertexArray(VAO);
+			glDrawElements(GL_TRIANGLES, indexCount, indexType, 0);
+		}
+		if (profiler)
+			profiler->pop();
+
+		if (options.benchmark)
+			frameStats.endGpu();
+
+		// Queue readbacks before the swap, while the back buffer still holds this frame
+		if (options.wantsCapture())
+		{
+			GpuScope scope(profiler, "readback");
+			if (options.readbackAll || frame == options.captureFrame)
+			{
+				GLint viewport[4];
+				glGetIntegerv(GL_VIEWPORT, viewport);
+				readback.request(viewport[2], viewport[3], frame);
+			}
+			Image image;
+			readback.poll(false);
+			while (readback.pop(image))
+				if (image.frame == options.captureFrame)
+					captured = image;
+		}
+		if (profiler)
+		{
+			profiler->pop();
+			profiler->endFrame();
+		}
+
+		renderScope.end();
 
 		// glfw: swaps buffers then polls for IO events
 		// --------------------------------------------
-		glfwSwapBuffers(window);
-		glfwPollEvents();
+		if (window)
+		{
+			CpuTraceScope swapScope("swap");
+			glfwSwapBuffers(window);
+			swapScope.end();
+			CPU_TRACE_SCOPE("poll");
+			glfwPollEvents();
+		}
+		pacer.frameSubmitted();
+		inputLatency.frameSubmitted();
+		inputLatency.poll(false);
+
+		if (frame == 1)
+			std::cout << "First frame after " << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startupStart).count()
+				<< " ms" << std::endl;
+
+		// Poll shader builds once the frame is submitted, so a blocking query never delays it
+		// ------------------------------------------------------------------------------------
+		if (fallbackProgram == 0 && shaderPipeline.isReady(fallbackBuild))
+			fallbackProgram = shaderPipeline.getProgram(fallbackBuild);
+		if (!programBuildDone && shaderPipeline.isReady(programBuild))
+		{
+			programBuildDone = true;
+			shaderProgram = shaderPipeline.getProgram(programBuild);
+			std::cout << "Shader program ready after " << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startupStart).count()
+				<< " ms (parallel compile " << (shaderPipeline.isParallel() ? "on" : "off") << ")" << std::endl;
+		}
+	}
+
+	// Report throughput once all queued GL work has completed
+	// -------------------------------------------------------
+	glFinish();
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - loopStart).count();
+	if (options.headless && !options.benchmark)
+		std::cout << "Rendered " << frame << " frames in " << seconds * 1000.0 << " ms ("
+			<< (seconds > 0.0 ? frame / seconds : 0.0) << " fps)" << std::endl;
+
+	// Report simulation rate and input-to-photon latency
+	// --------------------------------------------------
+	inputLatency.poll(true);
+	if (frame > 0)
+	{
+		TimingSummary latency = summarizeTimings(inputLatency.getSamples());
+		if (options.benchmark)
+		{
+			frameStats.addCounter("sim_hz", options.simulationHz);
+			frameStats.addCounter("sim_steps", (double)timestep.getSteps());
+			frameStats.addCounter("sim_steps_dropped", (double)timestep.getDroppedSteps());
+			frameStats.addCounter("input_latency_samples", (double)inputLatency.getSamples().size());
+			frameStats.addCounter("input_latency_median_ms", latency.median);
+			frameStats.addCounter("input_latency_p99_ms", latency.p99);
+		}
+		else
+			std::cout << "Simulation: " << timestep.getSteps() << " steps at " << options.simulationHz << " Hz ("
+				<< timestep.getDroppedSteps() << " dropped), input-to-photon latency median " << latency.median
+				<< " ms, p99 " << latency.p99 << " ms over " << inputLatency.getSamples().size() << " inputs" << std::endl;
+	}
+	inputLatency.destroy();
+
+	// Report the vertex and index buffers, compare runs with --vertex-format for the memory and frame time saved
+	// ----------------------------------------------------------------------------------------------------------
+	if (options.benchmark)
+	{
+		frameStats.addCounter("vertex_stride", getVertexStride(vertexFormat));
+		frameStats.addCounter("vertex_buffer_bytes", (double)vertexCount * getVertexStride(vertexFormat));
+		frameStats.addCounter("index_size", indexSize);
+		frameStats.addCounter("index_buffer_bytes", (double)indexCount * indexSize);
+	}
+
+	// Report frame pacing
+	// -------------------
+	if (options.benchmark)
+	{
+		frameStats.addCounter("swap_interval", swapInterval);
+		frameStats.addCounter("max_frames_in_flight", options.maxFramesInFlight);
+		frameStats.addCounter("fps_cap", options.fpsCap);
+		frameStats.addCounter("pacing_fence_waits", pacer.getFenceWaits());
+		frameStats.addCounter("pacing_fence_wait_ms", pacer.getFenceWaitMs());
+		frameStats.addCounter("pacing_sleep_ms", pacer.getSleepMs());
+		frameStats.addCounter("pacing_spin_ms", pacer.getSpinMs());
+	}
+	else if (options.histogram)
+	{
+		TimingSummary intervals = summarizeTimings(pacer.getFrameIntervals());
+		std::cout << "Frame times: median " << intervals.median << " ms, p99 " << intervals.p99 << " ms, max " << intervals.max
+			<< " ms (" << pacer.getFenceWaits() << " fence waits, " << pacer.getFenceWaitMs() << " ms waited)" << std::endl;
+		printHistogram(std::cout, buildHistogram(pacer.getFrameIntervals(), 0.5, 100));
+	}
+	pacer.destroy();
+
+	// Report batching statistics
+	// --------------------------
+	if (options.quads && frame > 0)
+	{
+		double drawsPerFrame = (double)batchedDraws / frame;
+		if (options.benchmark)
+		{
+			frameStats.addCounter("quads_per_frame", options.quads);
+			frameStats.addCounter("draws_per_frame", drawsPerFrame);
+			frameStats.addCounter("stream_buffer_waits", quadBatch.getStreamBuffer().getWaits());
+		}
+		else
+			std::cout << "Quad batch: " << options.quads << " quads, " << drawsPerFrame << " draws/frame (batch size "
+				<< options.batchSize << ", " << (quadBatch.getStreamBuffer().isPersistent() ? "persistent" : "staged")
+			<< " stream buffer, " << quadBatch.getStreamBuffer().getWaits() << " fence waits)" << std::endl;
+	}
+	quadBatch.destroy();
+
+	// Finish outstanding readbacks and check the captured frame
+	// ---------------------------------------------------------
+	int exitCode = 0;
+	if (options.wantsCapture())
+	{
+		Image image;
+		readback.poll(true);
+		while (readback.pop(image))
+			if (image.frame == options.captureFrame)
+				captured = image;
+		if (options.benchmark)
+		{
+			frameStats.addCounter("readbacks", readback.getCompleted());
+			frameStats.addCounter("readback_stalls", readback.getStalls());
+			frameStats.addCounter("readback_latency_ms", readback.getMeanLatencyMs());
+			frameStats.addCounter("readback_copy_mb_per_s", readback.getCopyMBps());
+		}
+		else if (options.readbackAll)
+			std::cout << "Readback: " << readback.getCompleted() << " frames, " << readback.getStalls() << " stalls, "
+				<< readback.getMeanLatencyMs() << " ms mean latency, " << readback.getCopyMBps() << " MB/s map+copy" << std::endl;
+		readback.destroy();
+		exitCode = checkCapture(options, captured);
+	}
+	if (options.animate && frame > 0)
+	{
+		if (options.benchmark)
+		{
+			frameStats.addCounter("job_threads", jobSystem.getThreadCount());
+			frameStats.addCounter("visible_per_frame", (double)visibleTotal / frame);
+			if (options.bvh)
+			{
+				frameStats.addCounter("bvh_nodes", (double)gridCulling.bvh.getNodeCount());
+				frameStats.addCounter("bvh_builds", gridCulling.bvhBuilds);
+				frameStats.addCounter("bvh_nodes_visited_per_frame", (double)gridCulling.bvhVisited / frame);
+			}
+		}
+		else
+		{
+			std::cout << "Animation: " << jobSystem.getThreadCount() << " job threads, " << (double)visibleTotal / frame
+				<< " of " << (options.instances ? options.instances : options.queueItems) << " visible/frame ("
+				<< (options.bvh ? "BVH" : cullSimdPath()) << " frustum culling)" << std::endl;
+			if (options.bvh)
+				std::cout << "BVH: " << gridCulling.bvh.getNodeCount() << " nodes, " << gridCulling.bvhBuilds << " builds, "
+					<< (double)gridCulling.bvhVisited / frame << " nodes visited/frame" << std::endl;
+		}
+	}
+	if (options.instances)
+	{
+		if (options.benchmark)
+		{
+			frameStats.addCounter("instances", options.instances);
+			frameStats.addCounter("draws_per_frame", options.perObject ? options.instances : 1);
+		}
+		instancedRenderer.destroy();
+	}
+
+	if (options.queueItems && frame > 0)
+	{
+		double programChanges = (double)queueChanges.programChanges / frame;
+		if (options.benchmark)
+		{
+			frameStats.addCounter("queue_items", options.queueItems);
+			frameStats.addCounter("queue_program_changes_per_frame", programChanges);
+			if (options.parallelRecord)
+			{
+				frameStats.addCounter("record_threads", recorder.getThreadCount());
+				frameStats.addCounter("recorded_bytes_per_frame", (double)recordedBytes / frame);
+			}
+		}
+		else
+			std::cout << "Render queue: " << options.queueItems << " items, " << programChanges << " program changes/frame ("
+				<< (options.sortQueue ? "sorted" : "unsorted") << ")" << std::endl;
+	}
+
+	// Report how many state changes reached the driver
+	// -------------------------------------------------
+	if (frame > 0)
+	{
+		const GLStateCounters &stateCounters = glState.getTotalCounters();
+		double issuedPerFrame = (double)stateCounters.issued / frame;
+		double elidedPerFrame = (double)stateCounters.elided / frame;
+		if (options.benchmark)
+		{
+			frameStats.addCounter("gl_state_calls_issued_per_frame", issuedPerFrame);
+			frameStats.addCounter("gl_state_calls_elided_per_frame", elidedPerFrame);
+		}
+		else if (options.headless)
+			std::cout << "GL state: " << issuedPerFrame << " calls/frame issued, " << elidedPerFrame << " elided (filtering "
+				<< (glState.isFiltering() ? "on" : "off") << ")" << std::endl;
+	}
+
+	// Report GPU scopes
+	// -----------------
+	if (profiler)
+	{
+		profiler->finish();
+		const std::vector<GpuScopeStats> &scopes = profiler->getStats();
+		if (options.benchmark)
+		{
+			for (size_t i = 0; i < scopes.size(); i++)
+				frameStats.addCounter(std::string("gpu_scope_") + scopes[i].name + "_ms", scopes[i].gpuTotalMs / scopes[i].calls);
+			frameStats.addCounter("gpu_scope_stalls", profiler->getStalls());
+		}
+		else
+			profiler->printStats(std::cout);
+
+		if (!options.gpuTracePath.empty())
+		{
+			std::ofstream file(options.gpuTracePath.c_str());
+			if (file)
+				profiler->writeChromeTrace(file);
+			else
+				std::cout << "ERROR::GPU_PROFILER::CANNOT_WRITE " << options.gpuTracePath << std::endl;
+		}
+		profiler->destroy();
+	}
+
+	// Write the CPU trace
+	// -------------------
+	if (!options.cpuTracePath.empty())
+	{
+		std::ofstream file(options.cpuTracePath.c_str());
+		if (file)
+			writeCpuTrace(file);
+		else
+			std::cout << "ERROR::CPU_TRACE::CANNOT_WRITE " << options.cpuTracePath << std::endl;
+	}
+
+	// Emit benchmark results
+	// ----------------------
+	if (options.benchmark)
+	{
+		frameStats.finish();
+		if (options.benchmarkOutput.empty())
+			frameStats.writeJson(std::cout);
+		else
+		{
+			std::ofstream file(options.benchmarkOutput.c_str());
+			if (file)
+				frameStats.writeJson(file);
+			if (!file)
+			{
+				std::cout << "ERROR::BENCHMARK::CANNOT_WRITE " << options.benchmarkOutput << std::endl;
+				exitCode = 1;
+			}
+		}
+		frameStats.destroy();
 	}
 
 	// De-allocate all resources once we're done with them
 	// ---------------------------------------------------
-	glDeleteVertexArrays(1, &VAO);
-	glDeleteBuffers(1, &VBO);
-	glDeleteBuffers(1, &EBO);
+	glState.deleteVertexArrays(1, &VAO);
+	glState.deleteBuffers(1, &VBO);
+	glState.deleteBuffers(1, &EBO);
+	shaderPipeline.finishAll();
+	glDeleteProgram(shaderPipeline.getProgram(programBuild));
+	glDeleteProgram(shaderPipeline.getProgram(fallbackBuild));
 
 	// glfw: terminate, clearing all previously allocated GLFW resources
 	// -----------------------------------------------------------------
-	glfwTerminate();
+	if (options.headless)
+		destroyHeadlessContext(headless);
+	else
+		glfwTerminate();
+	return exitCode;
+}
+
+// Queue count quads laid out on a square grid covering the viewport
+// ------------------------------------------------------------------
+void submitQuadGrid(QuadBatch &batch, unsigned int count, unsigned int materialA, unsigned int materialB)
+{
+	unsigned int columns = (unsigned int)std::ceil(std::sqrt((double)count));
+	float cell = 2.0f / columns;
+	float size = cell * 0.8f;
+	for (unsigned int i = 0; i < count; i++)
+	{
+		float x = -1.0f + (i % columns) * cell + cell * 0.1f;
+		float y = -1.0f + (i / columns) * cell + cell * 0.1f;
+		batch.submit(i % 2 ? materialB : materialA, x, y, size, size);
+	}
+}
+
+// Animate every grid instance for the given time and keep the ones inside the frustum, in grid order
+// ---------------------------------------------------------------------------------------------------
+void animateGrid(JobSystem &jobs, const std::vector<InstanceData> &grid, float time, GridCulling &culling,
+	std::vector<InstanceData> &visible)
+{
+	// Each chunk animates its range and fills in its bounds, culls them 8 at a time and compacts its
+	// visible instances to the front of the range, then the ranges are joined. Chunks start on a
+	// culling batch so their batches, and the indices each batch stores, never overlap
+	// With a BVH the chunks only animate, the tree is then refitted and culled on this thread
+	size_t chunkCount = std::min<size_t>(jobs.getThreadCount() * 4, grid.size() / 1024 + 1);
+	auto chunkStart = [&](size_t chunk) {
+		return chunk == chunkCount ? grid.size() : grid.size() * chunk / chunkCount / CULL_BATCH_SIZE * CULL_BATCH_SIZE;
+	};
+	float meshCenter[3], meshExtent[3];
+	for (int axis = 0; axis < 3; axis++)
+	{
+		meshCenter[axis] = (culling.meshMin[axis] + culling.meshMax[axis]) * 0.5f;
+		meshExtent[axis] = (culling.meshMax[axis] - culling.meshMin[axis]) * 0.5f;
+	}
+	std::vector<size_t> chunkVisible(chunkCount);
+	visible.resize(grid.size());
+	if (culling.useBvh)
+		culling.animated.resize(grid.size());
+	std::vector<InstanceData> &animated = culling.useBvh ? culling.animated : visible;
+	culling.bounds.resize(grid.size());
+	culling.visibleIndices.resize((grid.size() + CULL_BATCH_SIZE - 1) / CULL_BATCH_SIZE * CULL_BATCH_SIZE);
+	jobs.parallelFor(chunkCount, 1, [&](size_t firstChunk, size_t lastChunk) {
+		for (size_t chunk = firstChunk; chunk < lastChunk; chunk++)
+		{
+			size_t first = chunkStart(chunk);
+			size_t last = chunkStart(chunk + 1);
+			for (size_t i = first; i < last; i++)
+			{
+				// The shader scales x and y by the instance's scale and offsets them, z is untouched
+				const InstanceData &instance = animated[i];
+				animateInstance(grid[i], time, animated[i]);
+				float center[3] = { meshCenter[0], meshCenter[1], meshCenter[2] };
+				float extent[3] = { meshExtent[0], meshExtent[1], meshExtent[2] };
+				for (int axis = 0; axis < 2; axis++)
+				{
+					center[axis] = center[axis] * instance.scale + instance.offset[axis];
+					extent[axis] *= instance.scale;
+				}
+				culling.bounds.setBox(i, center, extent);
+			}
+			if (culling.useBvh)
+				continue;
+
+			// Indices only grow, so compacting forwards never overwrites an instance still to be moved
+			unsigned int *indices = &culling.visibleIndices[first];
+			size_t kept = cullFrustum(culling.frustum, culling.bounds, CULL_BOXES, first, last, indices);
+			for (size_t k = 0; k < kept; k++)
+				visible[first + k] = visible[indices[k]];
+			chunkVisible[chunk] = kept;
+		}
+	});
+
+	if (culling.useBvh)
+	{
+		if (culling.bvh.getNodeCount())
+			culling.bvh.refit(culling.bounds);
+		if (!culling.bvh.getNodeCount() || culling.bvh.getCost() > culling.bvh.getBuildCost() * BVH_REBUILD_RATIO)
+		{
+			culling.bvh.build(culling.bounds);
+			culling.bvhBuilds++;
+		}
+		size_t kept = culling.bvh.cullFrustum(culling.frustum, culling.bounds, culling.visibleIndices.data());
+		culling.bvhVisited += culling.bvh.getVisitedNodes();
+		// The tree emits them in its own order, sorting keeps the draw order of the linear path
+		std::sort(culling.visibleIndices.begin(), culling.visibleIndices.begin() + kept);
+		for (size_t k = 0; k < kept; k++)
+			visible[k] = culling.animated[culling.visibleIndices[k]];
+		visible.resize(kept);
+		return;
+	}
+
+	size_t total = 0;
+	for (size_t chunk = 0; chunk < chunkCount; chunk++)
+	{
+		size_t first = chunkStart(chunk);
+		if (total != first)
+			std::copy(visible.begin() + first, visible.begin() + first + chunkVisible[chunk], visible.begin() + total);
+		total += chunkVisible[chunk];
+	}
+	visible.resize(total);
+}
+
+// Render the same quad (or instance grid) with the CPU rasterizer and report its hash
+// -----------------------------------------------------------------------------------
+int runSoftwareRenderer(const Options &options)
+{
+	SoftRasterizer rasterizer;
+	rasterizer.init(SCR_WIDTH, SCR_HEIGHT, options.threads);
+
+	// Without --instances the quad is drawn once with the default instance attributes
+	std::vector<InstanceData> instances;
+	if (options.instances)
+		generateInstanceGrid(options.instances, instances);
+	else
+	{
+		InstanceData quad = { { 0.0f, 0.0f }, 1.0f, { 1.0f, 0.5f, 0.2f, 1.0f } };
+		instances.push_back(quad);
+	}
+
+	const float clearColor[4] = { 0.2f, 0.3f, 0.3f, 1.0f };
+	Image captured;
+	FrameStats frameStats;
+	frameStats.setRenderer(std::string("software rasterizer (") + SoftRasterizer::simdPath() + ")");
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (unsigned int frame = 0; frame < options.frames; frame++)
+	{
+		frameStats.beginFrame();
+		rasterizer.clear(clearColor);
+		rasterizer.drawElementsInstanced(vertices, 4, indices, 6, instances.data(), (unsigned int)instances.size());
+
+		if (options.wantsCapture() && frame + 1 == options.captureFrame)
+		{
+			captured.width = SCR_WIDTH;
+			captured.height = SCR_HEIGHT;
+			captured.frame = frame + 1;
+			rasterizer.getFramebuffer().copyTo(captured.rgba);
+		}
+	}
+	frameStats.finish();
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	int exitCode = options.wantsCapture() ? checkCapture(options, captured) : 0;
+
+	char hash[32];
+	std::snprintf(hash, sizeof(hash), "%016llx", rasterizer.getFramebuffer().hash());
+	if (options.benchmark)
+	{
+		frameStats.addCounter("threads", rasterizer.getThreadCount());
+		frameStats.addCounter("instances", (double)instances.size());
+		if (options.benchmarkOutput.empty())
+			frameStats.writeJson(std::cout);
+		else
+		{
+			std::ofstream file(options.benchmarkOutput.c_str());
+			if (file)
+				frameStats.writeJson(file);
+			if (!file)
+			{
+				std::cout << "ERROR::BENCHMARK::CANNOT_WRITE " << options.benchmarkOutput << std::endl;
+				exitCode = 1;
+			}
+		}
+	}
+	else
+		std::cout << "Software rasterizer (" << SoftRasterizer::simdPath() << ", " << rasterizer.getThreadCount() << " threads): "
+			<< options.frames << " frames in " << seconds * 1000.0 << " ms (" << (seconds > 0.0 ? options.frames / seconds : 0.0)
+			<< " fps), framebuffer hash " << hash << std::endl;
+	return exitCode;
+}
+
+// Write the captured frame and compare it with the golden image, returns the process exit code
+// ---------------------------------------------------------------------------------------------
+int checkCapture(const Options &options, const Image &image)
+{
+	if (image.rgba.empty())
+	{
+		if (!options.capturePath.empty() || !options.goldenPath.empty())
+		{
+			std::cout << "ERROR::CAPTURE::FRAME_NOT_CAPTURED " << options.captureFrame << std::endl;
+			return 1;
+		}
+		return 0;
+	}
+
+	if (!options.capturePath.empty() && !writePPM(options.capturePath, image))
+	{
+		std::cout << "ERROR::CAPTURE::CANNOT_WRITE " << options.capturePath << std::endl;
+		return 1;
+	}
+
+	if (options.goldenPath.empty())
+		return 0;
+	Image golden;
+	if (!readPPM(options.goldenPath, golden))
+	{
+		std::cout << "ERROR::CAPTURE::CANNOT_READ_GOLDEN " << options.goldenPath << std::endl;
+		return 1;
+	}
+	ImageDiff diff = compareImages(image, golden, options.tolerance);
+	if (!diff.sameSize)
+	{
+		std::cout << "Golden image FAILED: size " << image.width << "x" << image.height << " vs "
+			<< golden.width << "x" << golden.height << std::endl;
+		return 1;
+	}
+	if (diff.mismatchedPixels)
+	{
+		std::cout << "Golden image FAILED: " << diff.mismatchedPixels << " pixels differ by more than " << options.tolerance
+			<< " (max difference " << diff.maxDifference << ")" << std::endl;
+		return 1;
+	}
+	std::cout << "Golden image passed (max difference " << diff.maxDifference << ")" << std::endl;
 	return 0;
 }
 
@@ -190,6 +1103,23 @@ void processInput(GLFWwindow *window)
 		glfwSetWindowShouldClose(window, true);
 }
 
+// glfw: input callbacks, each one only timestamps the event for the latency measurement
+// ---------------------------------------------------------------------------------------
+void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods)
+{
+	((InputLatency *)glfwGetWindowUserPointer(window))->onInput();
+}
+
+void mouse_button_callback(GLFWwindow* window, int button, int action, int mods)
+{
+	((InputLatency *)glfwGetWindowUserPointer(window))->onInput();
+}
+
+void cursor_position_callback(GLFWwindow* window, double x, double y)
+{
+	((InputLatency *)glfwGetWindowUserPointer(window))->onInput();
+}
+
 // glfw: whenever the window is resized by user or OS, this callback function executes
 // -----------------------------------------------------------------------------------
 void framebuffer_size_callback(GLFWwindow* window, int width, int height)
@@ -0,0 +1,201 @@
+#include <glad/glad.h>
+
+#include "mesh.h"
+#include "gl_state.h"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static const char MESH_MAGIC[4] = { 'H', 'T', 'M', 'S' };
+static const unsigned int MESH_VERSION = 1;
+
+// MappedFile
+// ----------
+bool MappedFile::open(const std::string &path)
+{
+	close();
+#if defined(_WIN32)
+	file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		file = NULL;
+		return false;
+	}
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+	{
+		close();
+		return false;
+	}
+	mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mapping)
+		data = (const unsigned char *)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (!data)
+	{
+		close();
+		return false;
+	}
+	size = (size_t)fileSize.QuadPart;
+#else
+	descriptor = ::open(path.c_str(), O_RDONLY);
+	if (descriptor < 0)
+		return false;
+	struct stat status;
+	if (fstat(descriptor, &status) != 0 || status.st_size == 0)
+	{
+		close();
+		return false;
+	}
+	void *address = mmap(NULL, (size_t)status.st_size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+	if (address == MAP_FAILED)
+	{
+		close();
+		return false;
+	}
+	// The whole file is about to be read by the upload, start paging it in now
+	madvise(address, (size_t)status.st_size, MADV_WILLNEED);
+	data = (const unsigned char *)address;
+	size = (size_t)status.st_size;
+#endif
+	return true;
+}
+
+void MappedFile::close()
+{
+#if defined(_WIN32)
+	if (data)
+		UnmapViewOfFile(data);
+	if (mapping)
+		CloseHandle(mapping);
+	if (file)
+		CloseHandle(file);
+	mapping = NULL;
+	file = NULL;
+#else
+	if (data)
+		munmap((void *)data, size);
+	if (descriptor >= 0)
+		::close(descriptor);
+	descriptor = -1;
+#endif
+	data = NULL;
+	size = 0;
+}
+
+// Mesh files
+// ----------
+static bool blobInside(unsigned long long offset, unsigned long long bytes, size_t fileSize)
+{
+	return offset % MESH_ALIGNMENT == 0 && offset <= fileSize && bytes <= fileSize - offset;
+}
+
+bool openMesh(const MappedFile &file, MeshView &mesh)
+{
+	mesh = MeshView();
+	if (file.getSize() < sizeof(MeshFileHeader))
+	{
+		std::cout << "ERROR::MESH::FILE_TOO_SMALL" << std::endl;
+		return false;
+	}
+	const MeshFileHeader *header = (const MeshFileHeader *)file.getData();
+	if (std::memcmp(header->magic, MESH_MAGIC, sizeof(MESH_MAGIC)) != 0 || header->version != MESH_VERSION)
+	{
+		std::cout << "ERROR::MESH::UNKNOWN_FORMAT_OR_VERSION" << std::endl;
+		return false;
+	}
+	if (header->vertexFormat > MESH_VERTEX_POSITION_I10 || header->vertexStride != getVertexStride((MeshVertexFormat)header->vertexFormat)
+		|| (header->indexSize != 1 && header->indexSize != 2 && header->indexSize != 4))
+	{
+		std::cout << "ERROR::MESH::UNSUPPORTED_LAYOUT" << std::endl;
+		return false;
+	}
+	if (!blobInside(header->vertexOffset, (unsigned long long)header->vertexCount * header->vertexStride, file.getSize())
+		|| !blobInside(header->indexOffset, (unsigned long long)header->indexCount * header->indexSize, file.getSize()))
+	{
+		std::cout << "ERROR::MESH::TRUNCATED" << std::endl;
+		return false;
+	}
+
+	// Index values aren't range-checked, that would mean reading every index before the upload
+	mesh.header = header;
+	mesh.vertices = file.getData() + header->vertexOffset;
+	mesh.indices = file.getData() + header->indexOffset;
+	return true;
+}
+
+void uploadMesh(const MeshView &mesh, unsigned int vertexBuffer, unsigned int indexBuffer)
+{
+	glState.bindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+	glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)mesh.header->vertexCount * mesh.header->vertexStride, mesh.vertices, GL_STATIC_DRAW);
+
+	glState.bindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, (GLsizeiptr)mesh.header->indexCount * mesh.header->indexSize, mesh.indices, GL_STATIC_DRAW);
+}
+
+PositionQuantization getMeshQuantization(const MeshView &mesh)
+{
+	return computeQuantization((MeshVertexFormat)mesh.header->vertexFormat, mesh.header->boundsMin, mesh.header->boundsMax);
+}
+
+// Pads the stream with zeros up to the next MESH_ALIGNMENT boundary
+static unsigned long long alignStream(std::ofstream &out, unsigned long long offset)
+{
+	static const char zeros[MESH_ALIGNMENT] = {};
+	unsigned long long aligned = (offset + MESH_ALIGNMENT - 1) / MESH_ALIGNMENT * MESH_ALIGNMENT;
+	out.write(zeros, (std::streamsize)(aligned - offset));
+	return aligned;
+}
+
+bool writeMesh(const std::string &path, const float *positions, unsigned int vertexCount,
+	const unsigned int *indices, unsigned int indexCount, MeshVertexFormat format)
+{
+	MeshFileHeader header;
+	std::memset(&header, 0, sizeof(header));
+	std::memcpy(header.magic, MESH_MAGIC, sizeof(MESH_MAGIC));
+	header.version = MESH_VERSION;
+	header.vertexFormat = format;
+	header.vertexStride = getVertexStride(format);
+	header.vertexCount = vertexCount;
+	header.indexSize = chooseIndexSize(vertexCount);
+	header.indexCount = indexCount;
+	computeBounds(positions, vertexCount, header.boundsMin, header.boundsMax);
+	std::vector<unsigned char> vertices;
+	quantizePositions(format, computeQuantization(format, header.boundsMin, header.boundsMax), positions, vertexCount, vertices);
+	std::vector<unsigned char> packedIndices;
+	packIndices(indices, indexCount, header.indexSize, packedIndices);
+
+	unsigned long long vertexBytes = (unsigned long long)vertexCount * header.vertexStride;
+	header.vertexOffset = (sizeof(header) + MESH_ALIGNMENT - 1) / MESH_ALIGNMENT * MESH_ALIGNMENT;
+	header.indexOffset = (header.vertexOffset + vertexBytes + MESH_ALIGNMENT - 1) / MESH_ALIGNMENT * MESH_ALIGNMENT;
+
+	std::ofstream out(path.c_str(), std::ios::binary);
+	if (!out)
+	{
+		std::cout << "ERROR::MESH::CANNOT_WRITE " << path << std::endl;
+		return false;
+	}
+	out.write((const char *)&header, sizeof(header));
+	alignStream(out, sizeof(header));
+	out.write((const char *)vertices.data(), (std::streamsize)vertexBytes);
+	alignStream(out, header.vertexOffset + vertexBytes);
+	out.write((const char *)packedIndices.data(), (std::streamsize)packedIndices.size());
+	if (!out)
+	{
+		std::cout << "ERROR::MESH::CANNOT_WRITE " << path << std::endl;
+		return false;
+	}
+	return true;
+}
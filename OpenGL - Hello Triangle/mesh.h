@@ -0,0 +1,83 @@
+#ifndef MESH_H
+#define MESH_H
+
+#include "vertex_format.h"
+
+#include <cstddef>
+#include <string>
+
+// Binary mesh file (.htmesh)
+// A fixed header followed by the vertex and index blobs, each starting on a MESH_ALIGNMENT boundary,
+// in the layout the GL buffers use. Loading maps the file and hands the blobs to glBufferData as they
+// are: no parsing and no copy besides the driver's own
+// ---------------------------------------------------------------------------------------------------
+const unsigned int MESH_ALIGNMENT = 64;
+
+struct MeshFileHeader
+{
+	char magic[4];
+	unsigned int version;
+	// MeshVertexFormat, quantized formats are relative to the bounds
+	unsigned int vertexFormat;
+	unsigned int vertexStride;
+	unsigned int vertexCount;
+	// Bytes per index: 1, 2 or 4, see chooseIndexSize()
+	unsigned int indexSize;
+	unsigned int indexCount;
+	unsigned int reserved;
+	// Byte offsets from the start of the file
+	unsigned long long vertexOffset;
+	unsigned long long indexOffset;
+	// Axis-aligned bounds of the positions
+	float boundsMin[3];
+	float boundsMax[3];
+};
+
+// Read-only memory mapping of a whole file
+// ----------------------------------------
+class MappedFile
+{
+public:
+	MappedFile() {}
+	~MappedFile() { close(); }
+
+	bool open(const std::string &path);
+	void close();
+
+	const unsigned char *getData() const { return data; }
+	size_t getSize() const { return size; }
+
+private:
+	const unsigned char *data = NULL;
+	size_t size = 0;
+#if defined(_WIN32)
+	void *file = NULL;
+	void *mapping = NULL;
+#else
+	int descriptor = -1;
+#endif
+};
+
+// Header and blobs of a mesh, pointing into the mapping it was opened from
+struct MeshView
+{
+	const MeshFileHeader *header = NULL;
+	const void *vertices = NULL;
+	const void *indices = NULL;
+};
+
+// Checks the header and that both blobs lie inside the file
+bool openMesh(const MappedFile &file, MeshView &mesh);
+
+// Fills both buffers straight from the mapping, call with the vertex array to use them bound
+void uploadMesh(const MeshView &mesh, unsigned int vertexBuffer, unsigned int indexBuffer);
+
+// Scale and offset the vertex shader dequantizes the mesh's positions with
+PositionQuantization getMeshQuantization(const MeshView &mesh);
+
+// Writes vertices, encoded in format, and indices, narrowed to the smallest size that fits the
+// vertex count, as a mesh file
+bool writeMesh(const std::string &path, const float *positions, unsigned int vertexCount,
+	const unsigned int *indices, unsigned int indexCount, MeshVertexFormat format = MESH_VERTEX_POSITION_F32);
+
+#endif
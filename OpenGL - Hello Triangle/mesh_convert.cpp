@@ -0,0 +1,83 @@
+#include "job_system.h"
+#include "mesh.h"
+#include "mesh_import.h"
+#include "mesh_optimize.h"
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+// Converts an OBJ or PLY file to the binary mesh format loaded by --mesh
+// Only positions are kept; faces are triangulated as fans and duplicate vertices merged, then
+// triangles and vertices are reordered for the vertex cache, overdraw and vertex fetch, with the
+// cache efficiency reported before and after. --stats reports without writing a file
+// --vertex-format stores positions quantized (f32, u16 or i10), see vertex_format.h
+// Usage: hello_triangle_mesh_convert [--no-optimize] [--vertex-format F] input.obj|input.ply output.htmesh
+//        hello_triangle_mesh_convert --stats input.obj|input.ply
+// ---------------------------------------------------------------------------------------------
+
+static void printCacheStats(const char *label, const ImportedMesh &mesh)
+{
+	VertexCacheStats stats = analyzeVertexCache(mesh.indices, mesh.getVertexCount());
+	std::cout << label << ": ACMR " << stats.acmr << ", ATVR " << stats.atvr << " (" << stats.transformed
+		<< " vertices transformed, FIFO cache of " << VERTEX_CACHE_ANALYZE_SIZE << ")" << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+	bool optimize = true;
+	bool statsOnly = false;
+	MeshVertexFormat format = MESH_VERTEX_POSITION_F32;
+	int first = 1;
+	for (; first < argc && argv[first][0] == '-'; first++)
+	{
+		if (std::strcmp(argv[first], "--no-optimize") == 0)
+			optimize = false;
+		else if (std::strcmp(argv[first], "--stats") == 0)
+			statsOnly = true;
+		else if (std::strcmp(argv[first], "--vertex-format") == 0 && first + 1 < argc)
+		{
+			if (!parseVertexFormat(argv[++first], format))
+			{
+				std::cout << "ERROR::MESH_CONVERT::INVALID_VERTEX_FORMAT " << argv[first] << std::endl;
+				return -1;
+			}
+		}
+		else
+			break;
+	}
+	if (argc - first != (statsOnly ? 1 : 2))
+	{
+		std::cout << "Usage: " << argv[0] << " [--no-optimize] [--vertex-format F] input.obj|input.ply output.htmesh\n"
+			<< "       " << argv[0] << " --stats input.obj|input.ply" << std::endl;
+		return -1;
+	}
+	const char *input = argv[first];
+	const char *output = statsOnly ? NULL : argv[first + 1];
+
+	JobSystem jobs;
+	jobs.init(0);
+	ImportedMesh mesh;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	if (!importMesh(input, &jobs, mesh))
+		return -1;
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	jobs.shutdown();
+	std::cout << input << ": " << mesh.getVertexCount() << " vertices (" << mesh.sourceVertices << " before merging), "
+		<< mesh.getIndexCount() / 3 << " triangles, imported at " << (seconds > 0.0 ? mesh.sourceBytes / seconds / 1.0e6 : 0.0)
+		<< " MB/s" << std::endl;
+
+	if (optimize || statsOnly)
+	{
+		printCacheStats("Before", mesh);
+		start = std::chrono::steady_clock::now();
+		optimizeMesh(mesh.indices, mesh.positions);
+		seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		printCacheStats("After ", mesh);
+		std::cout << "Optimized in " << seconds * 1000.0 << " ms" << std::endl;
+	}
+
+	if (output && !writeMesh(output, mesh.positions.data(), mesh.getVertexCount(), mesh.indices.data(), mesh.getIndexCount(), format))
+		return -1;
+	return 0;
+}
@@ -0,0 +1,755 @@
+#include "mesh_import.h"
+#include "cpu_trace.h"
+#include "job_system.h"
+#include "mesh.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iostream>
+
+// Number parsing
+// --------------
+static inline bool isDigit(char c)
+{
+	return c >= '0' && c <= '9';
+}
+
+static inline bool isSpace(char c)
+{
+	return c == ' ' || c == '\t' || c == '\r';
+}
+
+const char *parseFloat(const char *text, const char *end, float &value)
+{
+	// Powers of ten up to 1e22 are exact doubles, so one multiply or divide rounds correctly
+	static const double POWERS_OF_TEN[] = {
+		1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+	};
+
+	const char *p = text;
+	bool negative = false;
+	if (p < end && (*p == '-' || *p == '+'))
+		negative = *p++ == '-';
+
+	unsigned long long mantissa = 0;
+	int digits = 0;
+	int exponent = 0;
+	bool truncated = false;
+	bool any = false;
+	for (; p < end && isDigit(*p); p++)
+	{
+		any = true;
+		if (digits < 19)
+		{
+			mantissa = mantissa * 10 + (*p - '0');
+			if (mantissa)
+				digits++;
+		}
+		else
+		{
+			exponent++;
+			truncated = true;
+		}
+	}
+	if (p < end && *p == '.')
+	{
+		for (p++; p < end && isDigit(*p); p++)
+		{
+			any = true;
+			if (digits < 19)
+			{
+				mantissa = mantissa * 10 + (*p - '0');
+				if (mantissa)
+					digits++;
+				exponent--;
+			}
+			else
+				truncated = true;
+		}
+	}
+	if (!any)
+		return text;
+
+	if (p < end && (*p == 'e' || *p == 'E'))
+	{
+		const char *e = p + 1;
+		bool negativeExponent = false;
+		if (e < end && (*e == '-' || *e == '+'))
+			negativeExponent = *e++ == '-';
+		if (e < end && isDigit(*e))
+		{
+			int written = 0;
+			for (; e < end && isDigit(*e); e++)
+				if (written < 10000)
+					written = written * 10 + (*e - '0');
+			exponent += negativeExponent ? -written : written;
+			p = e;
+		}
+	}
+
+	if (!truncated && mantissa < (1ULL << 53) && exponent >= -22 && exponent <= 22)
+	{
+		double result = (double)mantissa;
+		result = exponent < 0 ? result / POWERS_OF_TEN[-exponent] : result * POWERS_OF_TEN[exponent];
+		value = (float)(negative ? -result : result);
+		return p;
+	}
+
+	// Rare slow path: strtod needs a terminated copy
+	char buffer[128];
+	size_t length = std::min<size_t>(p - text, sizeof(buffer) - 1);
+	std::memcpy(buffer, text, length);
+	buffer[length] = 0;
+	value = (float)std::strtod(buffer, NULL);
+	return p;
+}
+
+// Parses an optionally signed integer, returns text on failure
+// Values past 18 digits saturate at +-10^18 instead of overflowing, which every index range check rejects
+static const char *parseInteger(const char *text, const char *end, long long &value)
+{
+	const long long SATURATED = 1000000000000000000LL;
+	const char *p = text;
+	bool negative = false;
+	if (p < end && (*p == '-' || *p == '+'))
+		negative = *p++ == '-';
+	if (p == end || !isDigit(*p))
+		return text;
+	long long result = 0;
+	for (; p < end && isDigit(*p); p++)
+		result = result < SATURATED / 10 ? result * 10 + (*p - '0') : SATURATED;
+	value = negative ? -result : result;
+	return p;
+}
+
+static inline const char *skipSpaces(const char *p, const char *end)
+{
+	while (p < end && isSpace(*p))
+		p++;
+	return p;
+}
+
+static inline const char *skipLine(const char *p, const char *end)
+{
+	while (p < end && *p != '\n')
+		p++;
+	return p < end ? p + 1 : p;
+}
+
+// Runs function(chunk) for every chunk, on the job system when there is one
+static void forEachChunk(JobSystem *jobs, size_t chunkCount, const std::function<void(size_t chunk)> &function)
+{
+	auto range = [&function](size_t first, size_t last) {
+		for (size_t chunk = first; chunk < last; chunk++)
+			function(chunk);
+	};
+	if (jobs)
+		jobs->parallelFor(chunkCount, 1, range);
+	else
+		range(0, chunkCount);
+}
+
+// Vertex deduplication
+// --------------------
+// Open addressing with linear probing over a power-of-two table; -0 is folded into +0 so the two
+// compare equal, every other value (NaNs included) merges only with the same bit pattern
+static void mergeDuplicateVertices(JobSystem *jobs, const std::vector<float> &source, ImportedMesh &mesh)
+{
+	CPU_TRACE_SCOPE("dedup vertices");
+	size_t vertexCount = source.size() / 3;
+	size_t tableSize = 16;
+	while (tableSize < vertexCount * 2)
+		tableSize *= 2;
+	std::vector<unsigned int> table(tableSize, 0);
+	std::vector<unsigned int> remap(vertexCount);
+
+	mesh.positions.clear();
+	mesh.positions.reserve(source.size());
+	for (size_t v = 0; v < vertexCount; v++)
+	{
+		unsigned int bits[3];
+		float position[3] = { source[v * 3] + 0.0f, source[v * 3 + 1] + 0.0f, source[v * 3 + 2] + 0.0f };
+		std::memcpy(bits, position, sizeof(bits));
+		unsigned int hash = (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+		hash ^= hash >> 16;
+
+		size_t slot = hash & (tableSize - 1);
+		for (;;)
+		{
+			unsigned int entry = table[slot];
+			if (entry == 0)
+			{
+				// Entries hold index + 1, 0 marks an empty slot
+				unsigned int index = (unsigned int)(mesh.positions.size() / 3);
+				table[slot] = index + 1;
+				mesh.positions.insert(mesh.positions.end(), position, position + 3);
+				remap[v] = index;
+				break;
+			}
+			if (std::memcmp(&mesh.positions[(entry - 1) * 3], position, sizeof(position)) == 0)
+			{
+				remap[v] = entry - 1;
+				break;
+			}
+			slot = (slot + 1) & (tableSize - 1);
+		}
+	}
+
+	std::vector<unsigned int> &indices = mesh.indices;
+	auto remapRange = [&](size_t first, size_t last) {
+		for (size_t i = first; i < last; i++)
+			indices[i] = remap[indices[i]];
+	};
+	if (jobs)
+		jobs->parallelFor(indices.size(), 65536, remapRange);
+	else
+		remapRange(0, indices.size());
+}
+
+// OBJ
+// ---
+// Face corners are triangulated while parsing. Positive indices are absolute and stored 0-based;
+// negative ones are relative to the vertices seen so far, which a chunk only knows locally, so they
+// are stored as the chunk-local index minus RELATIVE_CORNER and resolved once every chunk's vertex
+// count is known. The local index is negative when it points into an earlier chunk
+static const long long RELATIVE_CORNER = 1LL << 62;
+
+struct ObjChunk
+{
+	const char *begin;
+	const char *end;
+	std::vector<float> positions;
+	std::vector<long long> corners;
+	unsigned int badLine = 0;
+};
+
+static void parseObjChunk(ObjChunk &chunk)
+{
+	CPU_TRACE_SCOPE("parse obj chunk");
+	const char *p = chunk.begin;
+	const char *end = chunk.end;
+	long long face[64];
+	unsigned int line = 0;
+	while (p < end)
+	{
+		line++;
+		p = skipSpaces(p, end);
+		if (p + 1 < end && p[0] == 'v' && isSpace(p[1]))
+		{
+			p += 2;
+			for (int axis = 0; axis < 3; axis++)
+			{
+				float value = 0.0f;
+				p = parseFloat(skipSpaces(p, end), end, value);
+				chunk.positions.push_back(value);
+			}
+		}
+		else if (p + 1 < end && p[0] == 'f' && isSpace(p[1]))
+		{
+			p += 2;
+			unsigned int cornerCount = 0;
+			for (;;)
+			{
+				p = skipSpaces(p, end);
+				long long index = 0;
+				const char *next = parseInteger(p, end, index);
+				if (next == p)
+					break;
+				// Skip the texture coordinate and normal indices, only positions are kept
+				for (p = next; p < end && !isSpace(*p) && *p != '\n'; p++)
+					;
+				if (index == 0 || cornerCount == sizeof(face) / sizeof(face[0]))
+				{
+					chunk.badLine = chunk.badLine ? chunk.badLine : line;
+					continue;
+				}
+				face[cornerCount++] = index > 0 ? index - 1 : (long long)(chunk.positions.size() / 3) + index - RELATIVE_CORNER;
+			}
+			for (unsigned int i = 2; i < cornerCount; i++)
+			{
+				chunk.corners.push_back(face[0]);
+				chunk.corners.push_back(face[i - 1]);
+				chunk.corners.push_back(face[i]);
+			}
+		}
+		p = skipLine(p, end);
+	}
+}
+
+static bool importObj(const char *data, size_t size, JobSystem *jobs, ImportedMesh &mesh)
+{
+	// A few chunks per worker balances uneven lines; each chunk starts after a newline
+	size_t chunkCount = jobs ? jobs->getThreadCount() * 4 : 1;
+	chunkCount = std::max<size_t>(1, std::min<size_t>(chunkCount, size / 65536));
+	std::vector<ObjChunk> chunks(chunkCount);
+	const char *end = data + size;
+	const char *begin = data;
+	for (size_t c = 0; c < chunkCount; c++)
+	{
+		const char *split = c + 1 == chunkCount ? end : std::max(begin, data + size * (c + 1) / chunkCount);
+		while (split < end && split[-1] != '\n')
+			split++;
+		chunks[c].begin = begin;
+		chunks[c].end = split;
+		begin = split;
+	}
+
+	forEachChunk(jobs, chunkCount, [&chunks](size_t c) { parseObjChunk(chunks[c]); });
+
+	std::vector<size_t> vertexBase(chunkCount + 1, 0);
+	std::vector<size_t> cornerBase(chunkCount + 1, 0);
+	for (size_t c = 0; c < chunkCount; c++)
+	{
+		if (chunks[c].badLine)
+		{
+			std::cout << "ERROR::OBJ::BAD_FACE in chunk " << c << ", line " << chunks[c].badLine << std::endl;
+			return false;
+		}
+		vertexBase[c + 1] = vertexBase[c] + chunks[c].positions.size() / 3;
+		cornerBase[c + 1] = cornerBase[c] + chunks[c].corners.size();
+	}
+
+	// Concatenate the chunks, resolving relative indices and checking every index
+	size_t vertexCount = vertexBase[chunkCount];
+	std::vector<float> positions(vertexCount * 3);
+	mesh.indices.resize(cornerBase[chunkCount]);
+	std::atomic<bool> outOfRange(false);
+	forEachChunk(jobs, chunkCount, [&](size_t c) {
+		const ObjChunk &chunk = chunks[c];
+		std::copy(chunk.positions.begin(), chunk.positions.end(), positions.begin() + vertexBase[c] * 3);
+		for (size_t i = 0; i < chunk.corners.size(); i++)
+		{
+			long long corner = chunk.corners[i];
+			long long index = corner >= 0 ? corner : (long long)vertexBase[c] + corner + RELATIVE_CORNER;
+			if (index < 0 || index >= (long long)vertexCount)
+			{
+				outOfRange = true;
+				index = 0;
+			}
+			mesh.indices[cornerBase[c] + i] = (unsigned int)index;
+		}
+	});
+	if (outOfRange)
+	{
+		std::cout << "ERROR::OBJ::INDEX_OUT_OF_RANGE" << std::endl;
+		return false;
+	}
+
+	mesh.sourceVertices = vertexCount;
+	mergeDuplicateVertices(jobs, positions, mesh);
+	return true;
+}
+
+// PLY
+// ---
+enum PlyType
+{
+	PLY_INVALID,
+	PLY_INT8,
+	PLY_UINT8,
+	PLY_INT16,
+	PLY_UINT16,
+	PLY_INT32,
+	PLY_UINT32,
+	PLY_FLOAT32,
+	PLY_FLOAT64
+};
+
+struct PlyProperty
+{
+	std::string name;
+	PlyType type = PLY_INVALID;
+	// Lists are a count of countType followed by that many items of type
+	bool isList = false;
+	PlyType countType = PLY_INVALID;
+};
+
+struct PlyElement
+{
+	std::string name;
+	size_t count = 0;
+	std::vector<PlyProperty> properties;
+};
+
+static PlyType parsePlyType(const std::string &name)
+{
+	if (name == "char" || name == "int8") return PLY_INT8;
+	if (name == "uchar" || name == "uint8") return PLY_UINT8;
+	if (name == "short" || name == "int16") return PLY_INT16;
+	if (name == "ushort" || name == "uint16") return PLY_UINT16;
+	if (name == "int" || name == "int32") return PLY_INT32;
+	if (name == "uint" || name == "uint32") return PLY_UINT32;
+	if (name == "float" || name == "float32") return PLY_FLOAT32;
+	if (name == "double" || name == "float64") return PLY_FLOAT64;
+	return PLY_INVALID;
+}
+
+static size_t plyTypeSize(PlyType type)
+{
+	static const size_t SIZES[] = { 0, 1, 1, 2, 2, 4, 4, 4, 8 };
+	return SIZES[type];
+}
+
+// Reads a little-endian scalar, the byte copies keep unaligned reads well-defined
+static double readPlyScalar(const unsigned char *p, PlyType type)
+{
+	switch (type)
+	{
+	case PLY_INT8: return (double)(signed char)p[0];
+	case PLY_UINT8: return (double)p[0];
+	case PLY_INT16: { short v; std::memcpy(&v, p, 2); return v; }
+	case PLY_UINT16: { unsigned short v; std::memcpy(&v, p, 2); return v; }
+	case PLY_INT32: { int v; std::memcpy(&v, p, 4); return v; }
+	case PLY_UINT32: { unsigned int v; std::memcpy(&v, p, 4); return v; }
+	case PLY_FLOAT32: { float v; std::memcpy(&v, p, 4); return v; }
+	case PLY_FLOAT64: { double v; std::memcpy(&v, p, 8); return v; }
+	default: return 0.0;
+	}
+}
+
+// Reads the header up to and including "end_header", returns the offset of the body or 0
+static size_t parsePlyHeader(const char *data, size_t size, bool &binary, std::vector<PlyElement> &elements)
+{
+	const char *p = data;
+	const char *end = data + size;
+	bool formatSeen = false;
+	bool first = true;
+	while (p < end)
+	{
+		const char *lineEnd = p;
+		while (lineEnd < end && *lineEnd != '\n')
+			lineEnd++;
+		std::string line(p, lineEnd);
+		if (!line.empty() && line[line.size() - 1] == '\r')
+			line.erase(line.size() - 1);
+		p = lineEnd < end ? lineEnd + 1 : lineEnd;
+
+		std::vector<std::string> words;
+		size_t start = 0;
+		while (start < line.size())
+		{
+			size_t stop = line.find(' ', start);
+			if (stop == std::string::npos)
+				stop = line.size();
+			if (stop > start)
+				words.push_back(line.substr(start, stop - start));
+			start = stop + 1;
+		}
+		if (first)
+		{
+			if (words.size() != 1 || words[0] != "ply")
+				return 0;
+			first = false;
+		}
+		else if (words.empty() || words[0] == "comment" || words[0] == "obj_info")
+			continue;
+		else if (words[0] == "format" && words.size() >= 2)
+		{
+			if (words[1] == "ascii")
+				binary = false;
+			else if (words[1] == "binary_little_endian")
+				binary = true;
+			else
+			{
+				std::cout << "ERROR::PLY::UNSUPPORTED_FORMAT " << words[1] << std::endl;
+				return 0;
+			}
+			formatSeen = true;
+		}
+		else if (words[0] == "element" && words.size() == 3)
+		{
+			PlyElement element;
+			element.name = words[1];
+			element.count = (size_t)std::strtoull(words[2].c_str(), NULL, 10);
+			elements.push_back(element);
+		}
+		else if (words[0] == "property" && !elements.empty())
+		{
+			PlyProperty property;
+			if (words.size() == 5 && words[1] == "list")
+			{
+				property.isList = true;
+				property.countType = parsePlyType(words[2]);
+				property.type = parsePlyType(words[3]);
+				property.name = words[4];
+			}
+			else if (words.size() == 3)
+			{
+				property.type = parsePlyType(words[1]);
+				property.name = words[2];
+			}
+			if (property.type == PLY_INVALID || (property.isList && property.countType == PLY_INVALID))
+			{
+				std::cout << "ERROR::PLY::BAD_PROPERTY " << line << std::endl;
+				return 0;
+			}
+			elements.back().properties.push_back(property);
+		}
+		else if (words[0] == "end_header")
+			return formatSeen ? (size_t)(p - data) : 0;
+	}
+	return 0;
+}
+
+// Appends the fan triangulation of a polygon, returns false on an out-of-range index
+static bool addPlyFace(const long long *face, unsigned int cornerCount, size_t vertexCount, std::vector<unsigned int> &indices)
+{
+	for (unsigned int i = 0; i < cornerCount; i++)
+		if (face[i] < 0 || face[i] >= (long long)vertexCount)
+			return false;
+	for (unsigned int i = 2; i < cornerCount; i++)
+	{
+		indices.push_back((unsigned int)face[0]);
+		indices.push_back((unsigned int)face[i - 1]);
+		indices.push_back((unsigned int)face[i]);
+	}
+	return true;
+}
+
+static bool importPlyBinary(const unsigned char *p, const unsigned char *end, const std::vector<PlyElement> &elements,
+	JobSystem *jobs, std::vector<float> &positions, std::vector<unsigned int> &indices)
+{
+	for (size_t e = 0; e < elements.size(); e++)
+	{
+		const PlyElement &element = elements[e];
+		bool isVertex = element.name == "vertex";
+		bool isFace = element.name == "face";
+
+		// Vertices without lists have a fixed stride and are decoded in parallel
+		size_t stride = 0;
+		int axisOffset[3] = { -1, -1, -1 };
+		PlyType axisType[3] = { PLY_INVALID, PLY_INVALID, PLY_INVALID };
+		bool fixed = true;
+		for (size_t i = 0; i < element.properties.size(); i++)
+		{
+			const PlyProperty &property = element.properties[i];
+			fixed = fixed && !property.isList;
+			for (int axis = 0; axis < 3; axis++)
+				if (property.name == std::string(1, (char)('x' + axis)) && !property.isList)
+				{
+					axisOffset[axis] = (int)stride;
+					axisType[axis] = property.type;
+				}
+			stride += plyTypeSize(property.type);
+		}
+		if (isVertex && (axisOffset[0] < 0 || axisOffset[1] < 0 || axisOffset[2] < 0))
+		{
+			std::cout << "ERROR::PLY::VERTEX_WITHOUT_XYZ" << std::endl;
+			return false;
+		}
+
+		if (fixed)
+		{
+			if ((size_t)(end - p) / std::max<size_t>(stride, 1) < element.count)
+			{
+				std::cout << "ERROR::PLY::TRUNCATED" << std::endl;
+				return false;
+			}
+			if (isVertex)
+			{
+				CPU_TRACE_SCOPE("decode ply vertices");
+				positions.resize(element.count * 3);
+				auto decode = [&](size_t first, size_t last) {
+					for (size_t v = first; v < last; v++)
+						for (int axis = 0; axis < 3; axis++)
+							positions[v * 3 + axis] = (float)readPlyScalar(p + v * stride + axisOffset[axis], axisType[axis]);
+				};
+				if (jobs)
+					jobs->parallelFor(element.count, 65536, decode);
+				else
+					decode(0, element.count);
+			}
+			p += element.count * stride;
+			continue;
+		}
+
+		// Elements with lists are walked one item at a time, including vertices that carry a list
+		CPU_TRACE_SCOPE("decode ply lists");
+		if (isVertex)
+		{
+			// Every item holds at least its scalars and list counts, which bounds the count before allocating
+			size_t minimumSize = 0;
+			for (size_t i = 0; i < element.properties.size(); i++)
+				minimumSize += plyTypeSize(element.properties[i].isList ? element.properties[i].countType : element.properties[i].type);
+			if ((size_t)(end - p) / std::max<size_t>(minimumSize, 1) < element.count)
+			{
+				std::cout << "ERROR::PLY::TRUNCATED" << std::endl;
+				return false;
+			}
+			positions.resize(element.count * 3);
+		}
+		long long face[64];
+		for (size_t item = 0; item < element.count; item++)
+		{
+			for (size_t i = 0; i < element.properties.size(); i++)
+			{
+				const PlyProperty &property = element.properties[i];
+				size_t countSize = property.isList ? plyTypeSize(property.countType) : 0;
+				if ((size_t)(end - p) < countSize + (property.isList ? 0 : plyTypeSize(property.type)))
+				{
+					std::cout << "ERROR::PLY::TRUNCATED" << std::endl;
+					return false;
+				}
+				if (!property.isList)
+				{
+					if (isVertex && property.name.size() == 1 && property.name[0] >= 'x' && property.name[0] <= 'z')
+						positions[item * 3 + (property.name[0] - 'x')] = (float)readPlyScalar(p, property.type);
+					p += plyTypeSize(property.type);
+					continue;
+				}
+				size_t count = (size_t)readPlyScalar(p, property.countType);
+				p += countSize;
+				size_t itemSize = plyTypeSize(property.type);
+				if ((size_t)(end - p) / itemSize < count)
+				{
+					std::cout << "ERROR::PLY::TRUNCATED" << std::endl;
+					return false;
+				}
+				if (isFace && (property.name == "vertex_indices" || property.name == "vertex_index"))
+				{
+					if (count > sizeof(face) / sizeof(face[0]))
+					{
+						std::cout << "ERROR::PLY::FACE_TOO_LARGE" << std::endl;
+						return false;
+					}
+					for (size_t c = 0; c < count; c++)
+						face[c] = (long long)readPlyScalar(p + c * itemSize, property.type);
+					if (!addPlyFace(face, (unsigned int)count, positions.size() / 3, indices))
+					{
+						std::cout << "ERROR::PLY::INDEX_OUT_OF_RANGE" << std::endl;
+						return false;
+					}
+				}
+				p += count * itemSize;
+			}
+		}
+	}
+	return true;
+}
+
+static bool importPlyAscii(const char *p, const char *end, const std::vector<PlyElement> &elements,
+	std::vector<float> &positions, std::vector<unsigned int> &indices)
+{
+	CPU_TRACE_SCOPE("parse ply ascii");
+	for (size_t e = 0; e < elements.size(); e++)
+	{
+		const PlyElement &element = elements[e];
+		bool isVertex = element.name == "vertex";
+		bool isFace = element.name == "face";
+		// Every item holds at least one character per property, which bounds the count before allocating
+		if ((size_t)(end - p) / std::max<size_t>(element.properties.size(), 1) < element.count)
+		{
+			std::cout << "ERROR::PLY::TRUNCATED" << std::endl;
+			return false;
+		}
+		if (isVertex)
+			positions.resize(element.count * 3);
+
+		long long face[64];
+		for (size_t item = 0; item < element.count; item++)
+		{
+			if (p >= end)
+			{
+				std::cout << "ERROR::PLY::TRUNCATED" << std::endl;
+				return false;
+			}
+			for (size_t i = 0; i < element.properties.size(); i++)
+			{
+				const PlyProperty &property = element.properties[i];
+				size_t count = 1;
+				if (property.isList)
+				{
+					long long listCount = 0;
+					p = parseInteger(skipSpaces(p, end), end, listCount);
+					count = listCount > 0 ? (size_t)listCount : 0;
+					if (count > (size_t)(end - p))
+					{
+						std::cout << "ERROR::PLY::TRUNCATED" << std::endl;
+						return false;
+					}
+				}
+				bool faceIndices = isFace && property.isList && (property.name == "vertex_indices" || property.name == "vertex_index");
+				if (faceIndices && count > sizeof(face) / sizeof(face[0]))
+				{
+					std::cout << "ERROR::PLY::FACE_TOO_LARGE" << std::endl;
+					return false;
+				}
+				for (size_t c = 0; c < count; c++)
+				{
+					// Indices go through the integer parser, a float loses them past 2^24
+					if (faceIndices)
+					{
+						const char *text = skipSpaces(p, end);
+						p = parseInteger(text, end, face[c]);
+						if (p == text)
+						{
+							std::cout << "ERROR::PLY::BAD_FACE" << std::endl;
+							return false;
+						}
+						continue;
+					}
+					float value = 0.0f;
+					p = parseFloat(skipSpaces(p, end), end, value);
+					if (isVertex && property.name.size() == 1 && property.name[0] >= 'x' && property.name[0] <= 'z')
+						positions[item * 3 + (property.name[0] - 'x')] = value;
+				}
+				if (faceIndices && !addPlyFace(face, (unsigned int)count, positions.size() / 3, indices))
+				{
+					std::cout << "ERROR::PLY::INDEX_OUT_OF_RANGE" << std::endl;
+					return false;
+				}
+			}
+			p = skipLine(p, end);
+		}
+	}
+	return true;
+}
+
+static bool importPly(const char *data, size_t size, JobSystem *jobs, ImportedMesh &mesh)
+{
+	bool binary = false;
+	std::vector<PlyElement> elements;
+	size_t bodyOffset = parsePlyHeader(data, size, binary, elements);
+	if (bodyOffset == 0)
+	{
+		std::cout << "ERROR::PLY::BAD_HEADER" << std::endl;
+		return false;
+	}
+
+	std::vector<float> positions;
+	bool parsed = binary
+		? importPlyBinary((const unsigned char *)data + bodyOffset, (const unsigned char *)data + size, elements, jobs, positions, mesh.indices)
+		: importPlyAscii(data + bodyOffset, data + size, elements, positions, mesh.indices);
+	if (!parsed)
+		return false;
+
+	mesh.sourceVertices = positions.size() / 3;
+	mergeDuplicateVertices(jobs, positions, mesh);
+	return true;
+}
+
+// Entry points
+// ------------
+bool importMeshFromMemory(const char *data, size_t size, bool isPly, JobSystem *jobs, ImportedMesh &mesh)
+{
+	mesh = ImportedMesh();
+	mesh.sourceBytes = size;
+	return isPly ? importPly(data, size, jobs, mesh) : importObj(data, size, jobs, mesh);
+}
+
+bool importMesh(const std::string &path, JobSystem *jobs, ImportedMesh &mesh)
+{
+	CPU_TRACE_SCOPE("import mesh");
+	MappedFile file;
+	if (!file.open(path))
+	{
+		std::cout << "ERROR::MESH_IMPORT::CANNOT_OPEN " << path << std::endl;
+		return false;
+	}
+	bool isPly = path.size() >= 4 && (path.compare(path.size() - 4, 4, ".ply") == 0 || path.compare(path.size() - 4, 4, ".PLY") == 0);
+	return importMeshFromMemory((const char *)file.getData(), file.getSize(), isPly, jobs, mesh);
+}
@@ -0,0 +1,41 @@
+#ifndef MESH_IMPORT_H
+#define MESH_IMPORT_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+class JobSystem;
+
+// Geometry in the layout of the VAO set up in main.cpp: 3 floats of position per vertex and
+// 32-bit triangle indices, ready for glBufferData or writeMesh
+// -----------------------------------------------------------------------------------------
+struct ImportedMesh
+{
+	std::vector<float> positions;
+	std::vector<unsigned int> indices;
+
+	// Vertices in the file, before duplicates were merged
+	size_t sourceVertices = 0;
+	size_t sourceBytes = 0;
+
+	unsigned int getVertexCount() const { return (unsigned int)(positions.size() / 3); }
+	unsigned int getIndexCount() const { return (unsigned int)indices.size(); }
+};
+
+// Parses one float the way strtof does for the decimal forms OBJ and PLY use ("-1.5e-3", "7", ".5"),
+// without locale lookups. Exact whenever the digits fit 19 significant digits and the exponent is
+// small, otherwise it falls back to strtod. Returns the position after the number, or text on failure
+const char *parseFloat(const char *text, const char *end, float &value);
+
+// Imports a Wavefront OBJ or PLY (ascii / binary_little_endian) file, picked by extension
+// The file is memory-mapped; OBJ is split into chunks at line boundaries parsed in parallel on
+// jobs (serially when NULL), binary PLY vertices are decoded in parallel the same way. Faces are
+// triangulated as fans, and vertices with bit-identical positions are merged through a hash table
+// -----------------------------------------------------------------------------------------------
+bool importMesh(const std::string &path, JobSystem *jobs, ImportedMesh &mesh);
+
+// The same, from a buffer in memory; isPly picks the format
+bool importMeshFromMemory(const char *data, size_t size, bool isPly, JobSystem *jobs, ImportedMesh &mesh);
+
+#endif
@@ -0,0 +1,330 @@
+#include "mesh_optimize.h"
+#include "cpu_trace.h"
+
+#include <algorithm>
+#include <cmath>
+
+// FIFO cache simulation
+// ---------------------
+// A vertex is cached while fewer than cacheSize vertices were transformed after it; resetting
+// the cache only moves the clock, so a simulation costs one timestamp per vertex
+class FifoCache
+{
+public:
+	FifoCache(unsigned int vertexCount, unsigned int size) : timestamps(vertexCount, 0), cacheSize(size), now(size + 1) {}
+
+	// Returns the number of vertices the triangle had to transform
+	unsigned int addTriangle(const unsigned int *triangle)
+	{
+		unsigned int misses = 0;
+		for (int corner = 0; corner < 3; corner++)
+		{
+			unsigned int vertex = triangle[corner];
+			if (now - timestamps[vertex] > cacheSize)
+			{
+				timestamps[vertex] = now++;
+				misses++;
+			}
+		}
+		return misses;
+	}
+
+	void reset() { now += cacheSize + 1; }
+
+private:
+	std::vector<unsigned int> timestamps;
+	unsigned int cacheSize;
+	unsigned int now;
+};
+
+VertexCacheStats analyzeVertexCache(const std::vector<unsigned int> &indices, unsigned int vertexCount, unsigned int cacheSize)
+{
+	VertexCacheStats stats;
+	FifoCache cache(vertexCount, cacheSize);
+	std::vector<unsigned char> referenced(vertexCount, 0);
+	unsigned int unique = 0;
+	for (size_t i = 0; i + 2 < indices.size(); i += 3)
+	{
+		stats.transformed += cache.addTriangle(&indices[i]);
+		for (int corner = 0; corner < 3; corner++)
+			if (!referenced[indices[i + corner]])
+			{
+				referenced[indices[i + corner]] = 1;
+				unique++;
+			}
+	}
+	size_t triangles = indices.size() / 3;
+	stats.acmr = triangles ? (double)stats.transformed / triangles : 0.0;
+	stats.atvr = unique ? (double)stats.transformed / unique : 0.0;
+	return stats;
+}
+
+// Vertex cache
+// ------------
+static const unsigned int FORSYTH_CACHE_SIZE = 32;
+// Valences above this share the last valence score
+static const unsigned int FORSYTH_MAX_VALENCE = 64;
+
+struct ForsythTables
+{
+	float cache[FORSYTH_CACHE_SIZE];
+	float valence[FORSYTH_MAX_VALENCE + 1];
+
+	ForsythTables()
+	{
+		// The last triangle's three vertices score the same, no matter the order they were added in
+		for (unsigned int position = 0; position < FORSYTH_CACHE_SIZE; position++)
+			cache[position] = position < 3 ? 0.75f : std::pow(1.0f - (position - 3) / (float)(FORSYTH_CACHE_SIZE - 3), 1.5f);
+		// Vertices with few triangles left are finished first, so they don't strand triangles
+		valence[0] = 0.0f;
+		for (unsigned int remaining = 1; remaining <= FORSYTH_MAX_VALENCE; remaining++)
+			valence[remaining] = 2.0f / std::sqrt((float)remaining);
+	}
+
+	float score(int cachePosition, unsigned int remaining) const
+	{
+		if (remaining == 0)
+			return -1.0f;
+		return (cachePosition >= 0 ? cache[cachePosition] : 0.0f) + valence[std::min(remaining, FORSYTH_MAX_VALENCE)];
+	}
+};
+
+void optimizeVertexCache(std::vector<unsigned int> &indices, unsigned int vertexCount)
+{
+	CPU_TRACE_SCOPE("optimize vertex cache");
+	static const ForsythTables tables;
+	size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0)
+		return;
+
+	// Live triangles of every vertex, emitted ones are swapped past the end of the live range
+	std::vector<unsigned int> remaining(vertexCount, 0);
+	for (size_t i = 0; i < triangleCount * 3; i++)
+		remaining[indices[i]]++;
+	std::vector<unsigned int> offsets(vertexCount + 1, 0);
+	for (unsigned int v = 0; v < vertexCount; v++)
+		offsets[v + 1] = offsets[v] + remaining[v];
+	std::vector<unsigned int> adjacency(triangleCount * 3);
+	std::vector<unsigned int> filled(offsets.begin(), offsets.end() - 1);
+	for (size_t i = 0; i < triangleCount * 3; i++)
+		adjacency[filled[indices[i]]++] = (unsigned int)(i / 3);
+
+	std::vector<int> cachePosition(vertexCount, -1);
+	std::vector<float> vertexScores(vertexCount);
+	for (unsigned int v = 0; v < vertexCount; v++)
+		vertexScores[v] = tables.score(-1, remaining[v]);
+	std::vector<float> triangleScores(triangleCount);
+	std::vector<unsigned char> emitted(triangleCount, 0);
+	for (size_t t = 0; t < triangleCount; t++)
+		triangleScores[t] = vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]];
+
+	std::vector<unsigned int> output;
+	output.reserve(triangleCount * 3);
+	unsigned int cache[FORSYTH_CACHE_SIZE + 3];
+	unsigned int cacheCount = 0;
+	size_t cursor = 0;
+	long long best = (long long)(std::max_element(triangleScores.begin(), triangleScores.end()) - triangleScores.begin());
+
+	while (output.size() < triangleCount * 3)
+	{
+		// Dead end: nothing adjacent to the cache is left, continue with the next triangle in input order
+		if (best < 0)
+		{
+			while (emitted[cursor])
+				cursor++;
+			best = (long long)cursor;
+		}
+
+		const unsigned int *triangle = &indices[best * 3];
+		output.insert(output.end(), triangle, triangle + 3);
+		emitted[best] = 1;
+		for (int corner = 0; corner < 3; corner++)
+		{
+			unsigned int vertex = triangle[corner];
+			unsigned int *live = &adjacency[offsets[vertex]];
+			unsigned int *found = std::find(live, live + remaining[vertex], (unsigned int)best);
+			std::swap(*found, live[remaining[vertex] - 1]);
+			remaining[vertex]--;
+		}
+
+		// The triangle's vertices move to the front, the rest shift back and the tail falls out
+		unsigned int newCache[FORSYTH_CACHE_SIZE + 3];
+		unsigned int newCount = 0;
+		for (int corner = 0; corner < 3; corner++)
+			if (std::find(newCache, newCache + newCount, triangle[corner]) == newCache + newCount)
+				newCache[newCount++] = triangle[corner];
+		for (unsigned int i = 0; i < cacheCount; i++)
+			if (std::find(newCache, newCache + newCount, cache[i]) == newCache + newCount)
+				newCache[newCount++] = cache[i];
+
+		// Rescore everything whose cache position changed, including what was evicted
+		for (unsigned int i = 0; i < newCount; i++)
+			cachePosition[newCache[i]] = i < FORSYTH_CACHE_SIZE ? (int)i : -1;
+		best = -1;
+		float bestScore = -1.0f;
+		for (unsigned int i = 0; i < newCount; i++)
+		{
+			unsigned int vertex = newCache[i];
+			float score = tables.score(cachePosition[vertex], remaining[vertex]);
+			float delta = score - vertexScores[vertex];
+			vertexScores[vertex] = score;
+			const unsigned int *live = &adjacency[offsets[vertex]];
+			for (unsigned int j = 0; j < remaining[vertex]; j++)
+				triangleScores[live[j]] += delta;
+		}
+		for (unsigned int i = 0; i < newCount && i < FORSYTH_CACHE_SIZE; i++)
+		{
+			unsigned int vertex = newCache[i];
+			const unsigned int *live = &adjacency[offsets[vertex]];
+			for (unsigned int j = 0; j < remaining[vertex]; j++)
+				if (triangleScores[live[j]] > bestScore)
+				{
+					bestScore = triangleScores[live[j]];
+					best = live[j];
+				}
+		}
+
+		cacheCount = std::min(newCount, FORSYTH_CACHE_SIZE);
+		std::copy(newCache, newCache + cacheCount, cache);
+	}
+
+	indices.swap(output);
+}
+
+// Overdraw
+// --------
+struct TriangleCluster
+{
+	size_t first;
+	size_t last;
+	float sortKey;
+};
+
+void optimizeOverdraw(std::vector<unsigned int> &indices, const std::vector<float> &positions, float threshold)
+{
+	CPU_TRACE_SCOPE("optimize overdraw");
+	size_t triangleCount = indices.size() / 3;
+	unsigned int vertexCount = (unsigned int)(positions.size() / 3);
+	if (triangleCount < 2)
+		return;
+
+	// Hard boundaries: triangles that transform all three vertices, i.e. the cache starts over
+	std::vector<size_t> hard;
+	{
+		FifoCache cache(vertexCount, VERTEX_CACHE_ANALYZE_SIZE);
+		for (size_t t = 0; t < triangleCount; t++)
+			if (cache.addTriangle(&indices[t * 3]) == 3 || t == 0)
+				hard.push_back(t);
+		hard.push_back(triangleCount);
+	}
+
+	// Soft boundaries: split a hard cluster wherever the part so far, started on a cold cache, is
+	// within threshold of the whole cluster's ACMR
+	std::vector<TriangleCluster> clusters;
+	FifoCache cache(vertexCount, VERTEX_CACHE_ANALYZE_SIZE);
+	for (size_t h = 0; h + 1 < hard.size(); h++)
+	{
+		size_t first = hard[h];
+		size_t last = hard[h + 1];
+		cache.reset();
+		unsigned int clusterMisses = 0;
+		for (size_t t = first; t < last; t++)
+			clusterMisses += cache.addTriangle(&indices[t * 3]);
+		float limit = threshold * clusterMisses / (float)(last - first);
+
+		cache.reset();
+		unsigned int misses = 0;
+		size_t start = first;
+		for (size_t t = first; t < last; t++)
+		{
+			misses += cache.addTriangle(&indices[t * 3]);
+			if (t + 1 == last || misses / (float)(t + 1 - start) <= limit)
+			{
+				TriangleCluster cluster = { start, t + 1, 0.0f };
+				clusters.push_back(cluster);
+				cache.reset();
+				misses = 0;
+				start = t + 1;
+			}
+		}
+	}
+
+	// Sort key: how far the cluster's area-weighted centroid lies out along its average normal
+	float meshCentroid[3] = { 0.0f, 0.0f, 0.0f };
+	float meshArea = 0.0f;
+	std::vector<float> clusterData(clusters.size() * 7, 0.0f);
+	for (size_t c = 0; c < clusters.size(); c++)
+	{
+		float *data = &clusterData[c * 7];
+		for (size_t t = clusters[c].first; t < clusters[c].last; t++)
+		{
+			const float *a = &positions[indices[t * 3] * 3];
+			const float *b = &positions[indices[t * 3 + 1] * 3];
+			const float *d = &positions[indices[t * 3 + 2] * 3];
+			float e1[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+			float e2[3] = { d[0] - a[0], d[1] - a[1], d[2] - a[2] };
+			float normal[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+			float area = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+			for (int axis = 0; axis < 3; axis++)
+			{
+				data[axis] += (a[axis] + b[axis] + d[axis]) / 3.0f * area;
+				data[3 + axis] += normal[axis];
+			}
+			data[6] += area;
+		}
+		for (int axis = 0; axis < 3; axis++)
+			meshCentroid[axis] += data[axis];
+		meshArea += data[6];
+	}
+	for (int axis = 0; axis < 3; axis++)
+		meshCentroid[axis] = meshArea > 0.0f ? meshCentroid[axis] / meshArea : 0.0f;
+
+	for (size_t c = 0; c < clusters.size(); c++)
+	{
+		const float *data = &clusterData[c * 7];
+		float length = std::sqrt(data[3] * data[3] + data[4] * data[4] + data[5] * data[5]);
+		float key = 0.0f;
+		if (data[6] > 0.0f && length > 0.0f)
+			for (int axis = 0; axis < 3; axis++)
+				key += (data[axis] / data[6] - meshCentroid[axis]) * data[3 + axis] / length;
+		clusters[c].sortKey = key;
+	}
+	std::stable_sort(clusters.begin(), clusters.end(), [](const TriangleCluster &a, const TriangleCluster &b) {
+		return a.sortKey > b.sortKey;
+	});
+
+	std::vector<unsigned int> output;
+	output.reserve(indices.size());
+	for (size_t c = 0; c < clusters.size(); c++)
+		output.insert(output.end(), indices.begin() + clusters[c].first * 3, indices.begin() + clusters[c].last * 3);
+	indices.swap(output);
+}
+
+// Vertex fetch
+// ------------
+void optimizeVertexFetch(std::vector<unsigned int> &indices, std::vector<float> &positions)
+{
+	CPU_TRACE_SCOPE("optimize vertex fetch");
+	const unsigned int UNUSED = 0xFFFFFFFF;
+	std::vector<unsigned int> remap(positions.size() / 3, UNUSED);
+	std::vector<float> reordered;
+	reordered.reserve(positions.size());
+	for (size_t i = 0; i < indices.size(); i++)
+	{
+		unsigned int &target = remap[indices[i]];
+		if (target == UNUSED)
+		{
+			target = (unsigned int)(reordered.size() / 3);
+			reordered.insert(reordered.end(), &positions[indices[i] * 3], &positions[indices[i] * 3] + 3);
+		}
+		indices[i] = target;
+	}
+	positions.swap(reordered);
+}
+
+void optimizeMesh(std::vector<unsigned int> &indices, std::vector<float> &positions)
+{
+	optimizeVertexCache(indices, (unsigned int)(positions.size() / 3));
+	optimizeOverdraw(indices, positions);
+	optimizeVertexFetch(indices, positions);
+}
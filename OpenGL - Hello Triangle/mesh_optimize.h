@@ -0,0 +1,40 @@
+#ifndef MESH_OPTIMIZE_H
+#define MESH_OPTIMIZE_H
+
+#include <vector>
+
+// Post-transform vertex cache statistics of an index buffer, simulated with a FIFO cache
+// ACMR is vertices transformed per triangle (0.5 is ideal on a regular grid, 3 is the worst),
+// ATVR is vertices transformed per vertex referenced (1 is ideal)
+// ------------------------------------------------------------------------------------------
+struct VertexCacheStats
+{
+	unsigned int transformed = 0;
+	double acmr = 0.0;
+	double atvr = 0.0;
+};
+
+const unsigned int VERTEX_CACHE_ANALYZE_SIZE = 16;
+
+VertexCacheStats analyzeVertexCache(const std::vector<unsigned int> &indices, unsigned int vertexCount,
+	unsigned int cacheSize = VERTEX_CACHE_ANALYZE_SIZE);
+
+// Reorders triangles for the post-transform cache with Forsyth's greedy algorithm ("Linear-Speed
+// Vertex Cache Optimisation"): every step emits the best scored triangle of the vertices in a
+// simulated 32-entry LRU cache, scoring vertices by cache position and remaining triangle count
+void optimizeVertexCache(std::vector<unsigned int> &indices, unsigned int vertexCount);
+
+// Reorders clusters of a cache-optimized index buffer so outward-facing clusters far from the
+// centroid draw first and occlude the rest (Sander et al., "Fast Triangle Reordering for Vertex
+// Locality and Reduced Overdraw"). Clusters are cut where the cache restarts, then split further
+// while their ACMR stays within threshold of the whole cluster's, so the cache order is kept
+void optimizeOverdraw(std::vector<unsigned int> &indices, const std::vector<float> &positions, float threshold = 1.05f);
+
+// Reorders vertices by first use in the index buffer and rewrites the indices to match, so vertex
+// fetch walks memory forwards; unreferenced vertices are dropped. positions are 3 floats per vertex
+void optimizeVertexFetch(std::vector<unsigned int> &indices, std::vector<float> &positions);
+
+// All three passes in order: vertex cache, overdraw, vertex fetch
+void optimizeMesh(std::vector<unsigned int> &indices, std::vector<float> &positions);
+
+#endif
@@ -0,0 +1,298 @@
+#include "options.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+static void printUsage(const char *program)
+{
+	std::cout << "Usage: " << program << " [options]\n"
+		<< "  --headless     Render offscreen (EGL surfaceless context + FBO), no window\n"
+		<< "  --frames N     Render N frames then exit (headless default: " << DEFAULT_HEADLESS_FRAMES << ")\n"
+		<< "  --benchmark    Time each frame (CPU and GL_TIME_ELAPSED), vsync off, print JSON (default frames: " << DEFAULT_BENCHMARK_FRAMES << ")\n"
+		<< "  --benchmark-output FILE  Write the benchmark JSON to FILE instead of stdout\n"
+		<< "  --shader-cache DIR  Directory of the program binary cache (default: shader_cache)\n"
+		<< "  --no-shader-cache   Always compile and link shaders from source\n"
+		<< "  --no-state-cache    Forward every GL bind and state change, even redundant ones\n"
+		<< "  --quads N           Draw a grid of N quads through the quad batcher\n"
+		<< "  --batch-size N      Maximum quads per batched draw (default: 10000)\n"
+		<< "  --instances N       Draw N instances of the quad with glDrawElementsInstanced\n"
+		<< "  --per-object        Draw the instances with one glDrawElements each\n"
+		<< "  --queue N           Draw N quads as individual items through the sorted render queue\n"
+		<< "  --no-sort           Submit queued items unsorted\n"
+		<< "  --parallel-record   Record queued draws into command buffers on worker threads\n"
+		<< "  --animate           Animate and cull the --instances or --queue grid on worker threads\n"
+		<< "  --bvh               Cull --animate through a refitted BVH, left click picks an instance\n"
+		<< "  --sim-hz N          Fixed simulation and input rate in Hz (default: 60)\n"
+		<< "  --vsync MODE        off, on or adaptive (default: on, off with --benchmark)\n"
+		<< "  --max-frames-in-flight N  Let the CPU run at most N frames ahead of the GPU\n"
+		<< "  --fps-cap N         Limit the frame rate to N with sleep + spin\n"
+		<< "  --histogram         Print a frame time histogram on exit\n"
+		<< "  --mesh FILE         Draw a mesh (.htmesh, or .obj / .ply imported at startup) instead of the quad\n"
+		<< "  --vertex-format F   Vertex positions as f32, u16 or i10 (GL_INT_2_10_10_10_REV) (default: f32)\n"
+		<< "  --gpu-profile       Time frame sections on the GPU and print them on exit\n"
+		<< "  --gpu-trace FILE    Also write the sections as Chrome trace JSON\n"
+		<< "  --cpu-trace FILE    Write CPU startup and frame phases as Chrome trace JSON\n"
+		<< "  --software          Render with the CPU rasterizer, print the framebuffer hash\n"
+		<< "  --threads N         Worker threads for CPU work (default: all hardware threads)\n"
+		<< "  --capture FILE      Write the captured frame to FILE (PPM)\n"
+		<< "  --golden FILE       Compare the captured frame with FILE (PPM), exit with 1 on mismatch\n"
+		<< "  --capture-frame N   Frame to capture (default: the last one)\n"
+		<< "  --tolerance N       Per-channel difference accepted by --golden (default: 2)\n"
+		<< "  --readback-all      Read back every frame through PBOs and report throughput\n"
+		<< "  --help         Show this message" << std::endl;
+}
+
+// Reads the string following argv[i], advancing i past it
+static bool readString(int argc, char *argv[], int &i, std::string &value)
+{
+	if (i + 1 >= argc)
+	{
+		std::cout << "ERROR::OPTIONS::MISSING_VALUE " << argv[i] << std::endl;
+		return false;
+	}
+	value = argv[++i];
+	return true;
+}
+
+// Reads the unsigned integer following argv[i], advancing i past it
+static bool readUnsigned(int argc, char *argv[], int &i, unsigned int &value)
+{
+	if (i + 1 >= argc)
+	{
+		std::cout << "ERROR::OPTIONS::MISSING_VALUE " << argv[i] << std::endl;
+		return false;
+	}
+	char *end = NULL;
+	unsigned long parsed = std::strtoul(argv[i + 1], &end, 10);
+	if (end == argv[i + 1] || *end != '\0')
+	{
+		std::cout << "ERROR::OPTIONS::INVALID_NUMBER " << argv[i] << " " << argv[i + 1] << std::endl;
+		return false;
+	}
+	value = (unsigned int)parsed;
+	i++;
+	return true;
+}
+
+bool parseOptions(int argc, char *argv[], Options &options)
+{
+	for (int i = 1; i < argc; i++)
+	{
+		const char *arg = argv[i];
+		if (std::strcmp(arg, "--headless") == 0)
+			options.headless = true;
+		else if (std::strcmp(arg, "--frames") == 0)
+		{
+			if (!readUnsigned(argc, argv, i, options.frames))
+				return false;
+		}
+		else if (std::strcmp(arg, "--benchmark") == 0)
+			options.benchmark = true;
+		else if (std::strcmp(arg, "--benchmark-output") == 0)
+		{
+			if (!readString(argc, argv, i, options.benchmarkOutput))
+				return false;
+			options.benchmark = true;
+		}
+		else if (std::strcmp(arg, "--shader-cache") == 0)
+		{
+			if (!readString(argc, argv, i, options.shaderCacheDirectory))
+				return false;
+			options.shaderCache = true;
+		}
+		else if (std::strcmp(arg, "--no-shader-cache") == 0)
+			options.shaderCache = false;
+		else if (std::strcmp(arg, "--no-state-cache") == 0)
+			options.stateCache = false;
+		else if (std::strcmp(arg, "--quads") == 0)
+		{
+			if (!readUnsigned(argc, argv, i, options.quads))
+				return false;
+		}
+		else if (std::strcmp(arg, "--batch-size") == 0)
+		{
+			if (!readUnsigned(argc, argv, i, options.batchSize))
+				return false;
+			if (options.batchSize == 0)
+			{
+				std::cout << "ERROR::OPTIONS::INVALID_NUMBER --batch-size 0" << std::endl;
+				return false;
+			}
+		}
+		else if (std::strcmp(arg, "--instances") == 0)
+		{
+			if (!readUnsigned(argc, argv, i, options.instances))
+				return false;
+		}
+		else if (std::strcmp(arg, "--per-object") == 0)
+			options.perObject = true;
+		else if (std::strcmp(arg, "--queue") == 0)
+		{
+			if (!readUnsigned(argc, argv, i, options.queueItems))
+				return false;
+		}
+		else if (std::strcmp(arg, "--no-sort") == 0)
+			options.sortQueue = false;
+		else if (std::strcmp(arg, "--parallel-record") == 0)
+			options.parallelRecord = true;
+		else if (std::strcmp(arg, "--animate") == 0)
+			options.animate = true;
+		else if (std::strcmp(arg, "--bvh") == 0)
+			options.bvh = true;
+		else if (std::strcmp(arg, "--sim-hz") == 0)
+		{
+			if (!readUnsigned(argc, argv, i, options.simulationHz) || options.simulationHz == 0)
+				return false;
+		}
+		else if (std::strcmp(arg, "--vsync") == 0)
+		{
+			std::string mode;
+			if (!readString(argc, argv, i, mode))
+				return false;
+			if (mode == "off")
+				options.vsync = VSYNC_OFF;
+			else if (mode == "on")
+				options.vsync = VSYNC_ON;
+			else if (mode == "adaptive")
+				options.vsync = VSYNC_ADAPTIVE;
+			else
+			{
+				std::cout << "ERROR::OPTIONS::INVALID_VSYNC_MODE " << mode << std::endl;
+				return false;
+			}
+		}
+		else if (std::strcmp(arg, "--max-frames-in-flight") == 0)
+		{
+			if (!readUnsigned(argc, argv, i, options.maxFramesInFlight))
+				return false;
+		}
+		else if (std::strcmp(arg, "--fps-cap") == 0)
+		{
+			if (!readUnsigned(argc, argv, i, options.fpsCap))
+				return false;
+		}
+		else if (std::strcmp(arg, "--histogram") == 0)
+			options.histogram = true;
+		else if (std::strcmp(arg, "--mesh") == 0)
+		{
+			if (!readString(argc, argv, i, options.meshPath))
+				return false;
+		}
+		else if (std::strcmp(arg, "--vertex-format") == 0)
+		{
+			std::string format;
+			if (!readString(argc, argv, i, format))
+				return false;
+			if (!parseVertexFormat(format.c_str(), options.vertexFormat))
+			{
+				std::cout << "ERROR::OPTIONS::INVALID_VERTEX_FORMAT " << format << std::endl;
+				return false;
+			}
+		}
+		else if (std::strcmp(arg, "--gpu-profile") == 0)
+			options.gpuProfile = true;
+		else if (std::strcmp(arg, "--gpu-trace") == 0)
+		{
+			if (!readString(argc, argv, i, options.gpuTracePath))
+				return false;
+			options.gpuProfile = true;
+		}
+		else if (std::strcmp(arg, "--cpu-trace") == 0)
+		{
+			if (!readString(argc, argv, i, options.cpuTracePath))
+				return false;
+		}
+		else if (std::strcmp(arg, "--software") == 0)
+			options.software = true;
+		else if (std::strcmp(arg, "--threads") == 0)
+		{
+			if (!readUnsigned(argc, argv, i, options.threads))
+				return false;
+		}
+		else if (std::strcmp(arg, "--capture") == 0)
+		{
+			if (!readString(argc, argv, i, options.capturePath))
+				return false;
+		}
+		else if (std::strcmp(arg, "--golden") == 0)
+		{
+			if (!readString(argc, argv, i, options.goldenPath))
+				return false;
+		}
+		else if (std::strcmp(arg, "--capture-frame") == 0)
+		{
+			if (!readUnsigned(argc, argv, i, options.captureFrame))
+				return false;
+		}
+		else if (std::strcmp(arg, "--tolerance") == 0)
+		{
+			if (!readUnsigned(argc, argv, i, options.tolerance))
+				return false;
+		}
+		else if (std::strcmp(arg, "--readback-all") == 0)
+			options.readbackAll = true;
+		else if (std::strcmp(arg, "--help") == 0)
+		{
+			printUsage(argv[0]);
+			return false;
+		}
+		else
+		{
+			std::cout << "ERROR::OPTIONS::UNKNOWN_OPTION " << arg << std::endl;
+			printUsage(argv[0]);
+			return false;
+		}
+	}
+
+	if ((options.quads != 0) + (options.instances != 0) + (options.queueItems != 0) > 1)
+	{
+		std::cout << "ERROR::OPTIONS::CONFLICT --quads, --instances and --queue can't be combined" << std::endl;
+		return false;
+	}
+
+	if (options.parallelRecord && !options.queueItems)
+	{
+		std::cout << "ERROR::OPTIONS::CONFLICT --parallel-record needs --queue" << std::endl;
+		return false;
+	}
+
+	if (options.animate && !options.instances && !options.queueItems)
+	{
+		std::cout << "ERROR::OPTIONS::CONFLICT --animate needs --instances or --queue" << std::endl;
+		return false;
+	}
+
+	if (options.bvh && !options.animate)
+	{
+		std::cout << "ERROR::OPTIONS::CONFLICT --bvh needs --animate" << std::endl;
+		return false;
+	}
+
+	if (options.software && (options.quads || options.perObject || options.queueItems || options.animate))
+	{
+		std::cout << "ERROR::OPTIONS::CONFLICT --software only draws the quad or --instances" << std::endl;
+		return false;
+	}
+
+	// The batcher streams float quads through the same program, which can only dequantize one mesh
+	if ((options.quads || options.software) && (!options.meshPath.empty() || options.vertexFormat != MESH_VERTEX_POSITION_F32))
+	{
+		std::cout << "ERROR::OPTIONS::CONFLICT --mesh and --vertex-format don't apply to --quads or --software" << std::endl;
+		return false;
+	}
+
+	if (options.benchmark && options.frames == 0)
+		options.frames = DEFAULT_BENCHMARK_FRAMES;
+	else if ((options.headless || options.software) && options.frames == 0)
+		options.frames = DEFAULT_HEADLESS_FRAMES;
+
+	if (options.captureFrame == 0)
+		options.captureFrame = options.frames ? options.frames : 1;
+	if (options.frames != 0 && options.captureFrame > options.frames)
+	{
+		std::cout << "ERROR::OPTIONS::CAPTURE_FRAME_OUT_OF_RANGE " << options.captureFrame << std::endl;
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,90 @@
+#ifndef OPTIONS_H
+#define OPTIONS_H
+
+#include "frame_pacing.h"
+#include "vertex_format.h"
+
+#include <string>
+
+// Command line options
+// --------------------
+struct Options
+{
+	// Render into an offscreen framebuffer without a visible window
+	bool headless = false;
+	// Number of frames to render before exiting, 0 runs until the window is closed
+	unsigned int frames = 0;
+	// Time every frame and print min/median/p99/max as JSON on exit
+	bool benchmark = false;
+	// File the benchmark JSON is written to, stdout when empty
+	std::string benchmarkOutput;
+	// Load linked programs from / store them to an on-disk binary cache
+	bool shaderCache = true;
+	std::string shaderCacheDirectory = "shader_cache";
+	// Drop binds and state changes that set the value already current
+	bool stateCache = true;
+	// Draw a grid of this many quads through the quad batcher instead of the single quad
+	unsigned int quads = 0;
+	// Maximum number of quads drawn by one glDrawElements call of the batcher
+	unsigned int batchSize = 10000;
+	// Draw this many copies of the quad with one glDrawElementsInstanced call
+	unsigned int instances = 0;
+	// Draw the instances with one glDrawElements each instead, for comparison
+	bool perObject = false;
+	// Draw this many quads as separate items through the sorted render queue
+	unsigned int queueItems = 0;
+	// Submit queued items in the order they were pushed, for comparison
+	bool sortQueue = true;
+	// Record the queued draws as command buffers on --threads workers, replayed on the GL thread
+	bool parallelRecord = false;
+	// Move the --instances / --queue grid every frame and cull what leaves the viewport, on the job system
+	bool animate = false;
+	// Cull the animated grid through a bounding volume hierarchy, which also picks instances on click
+	bool bvh = false;
+	// Rate input is polled and the simulation stepped at, independent of the frame rate
+	unsigned int simulationHz = 60;
+	// Swap interval of the window
+	VsyncMode vsync = VSYNC_DEFAULT;
+	// Frames the CPU may queue ahead of the GPU, enforced with fences; 0 leaves it to the driver
+	unsigned int maxFramesInFlight = 0;
+	// Upper bound on the frame rate, 0 for none
+	unsigned int fpsCap = 0;
+	// Print a histogram of frame times on exit
+	bool histogram = false;
+	// Time the clear, draw and readback sections on the GPU with timestamp queries
+	bool gpuProfile = false;
+	// Chrome trace JSON of the profiled sections, implies --gpu-profile
+	std::string gpuTracePath;
+	// Chrome trace JSON of the CPU scope markers: startup phases, frame phases and jobs
+	std::string cpuTracePath;
+	// Mesh drawn instead of the built-in quad: .htmesh (see mesh_convert), or .obj / .ply imported at startup
+	std::string meshPath;
+	// Position format of the quad and imported meshes, .htmesh files keep the one they were written with
+	MeshVertexFormat vertexFormat = MESH_VERTEX_POSITION_F32;
+	// Render with the CPU rasterizer instead of OpenGL, no context or window is created
+	bool software = false;
+	// Worker threads of the CPU rasterizer, 0 uses every hardware thread
+	unsigned int threads = 0;
+	// Frame to read back, 0 means the last one (--frames) or the first one without a frame limit
+	unsigned int captureFrame = 0;
+	// PPM the captured frame is written to
+	std::string capturePath;
+	// PPM the captured frame is compared against, the process exits with 1 on a mismatch
+	std::string goldenPath;
+	// Largest per-channel difference from the golden image still accepted
+	unsigned int tolerance = 2;
+	// Read back every frame to measure readback throughput
+	bool readbackAll = false;
+
+	bool wantsCapture() const { return !capturePath.empty() || !goldenPath.empty() || readbackAll; }
+};
+
+// Number of frames rendered in headless mode when --frames isn't given
+const unsigned int DEFAULT_HEADLESS_FRAMES = 600;
+// Number of frames timed in benchmark mode when --frames isn't given
+const unsigned int DEFAULT_BENCHMARK_FRAMES = 1000;
+
+// Parses argv into options, prints usage and returns false on bad input
+bool parseOptions(int argc, char *argv[], Options &options);
+
+#endif
@@ -0,0 +1,163 @@
+#include <glad/glad.h>
+
+#include "program_cache.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+#if defined(_WIN32)
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+// Header written in front of every stored binary
+// ----------------------------------------------
+struct ProgramCacheHeader
+{
+	char magic[4];
+	unsigned int version;
+	unsigned long long key;
+	unsigned int format;
+	unsigned int length;
+};
+
+static const char PROGRAM_CACHE_MAGIC[4] = { 'H', 'T', 'P', 'B' };
+static const unsigned int PROGRAM_CACHE_VERSION = 1;
+
+// 64-bit FNV-1a, including the terminating zero so "ab" + "c" and "a" + "bc" differ
+static unsigned long long hashString(unsigned long long hash, const char *text)
+{
+	const unsigned char *bytes = (const unsigned char *)text;
+	do
+	{
+		hash ^= *bytes;
+		hash *= 1099511628211ULL;
+	} while (*bytes++);
+	return hash;
+}
+
+static bool makeDirectory(const std::string &path)
+{
+#if defined(_WIN32)
+	return _mkdir(path.c_str()) == 0 || errno == EEXIST;
+#else
+	return mkdir(path.c_str(), 0755) == 0 || errno == EEXIST;
+#endif
+}
+
+void ProgramCache::init(const std::string &cacheDirectory)
+{
+	enabled = false;
+	directory = cacheDirectory;
+
+	if (!GLAD_GL_VERSION_4_1 && !GLAD_GL_ARB_get_program_binary)
+	{
+		std::cout << "Program cache disabled: glGetProgramBinary not supported" << std::endl;
+		return;
+	}
+	GLint formats = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+	if (formats == 0)
+	{
+		std::cout << "Program cache disabled: driver exposes no program binary formats" << std::endl;
+		return;
+	}
+	if (!makeDirectory(directory))
+	{
+		std::cout << "ERROR::PROGRAM_CACHE::CANNOT_CREATE_DIRECTORY " << directory << std::endl;
+		return;
+	}
+
+	driverId = std::string((const char *)glGetString(GL_VENDOR)) + '\n'
+		+ (const char *)glGetString(GL_RENDERER) + '\n'
+		+ (const char *)glGetString(GL_VERSION);
+	enabled = true;
+}
+
+unsigned long long ProgramCache::computeKey(const char *vertexSource, const char *fragmentSource) const
+{
+	unsigned long long hash = 14695981039346656037ULL;
+	hash = hashString(hash, driverId.c_str());
+	hash = hashString(hash, vertexSource);
+	hash = hashString(hash, fragmentSource);
+	return hash;
+}
+
+std::string ProgramCache::entryPath(unsigned long long key) const
+{
+	char name[32];
+	std::snprintf(name, sizeof(name), "%016llx.bin", key);
+	return directory + "/" + name;
+}
+
+bool ProgramCache::load(unsigned long long key, unsigned int program)
+{
+	if (!enabled)
+		return false;
+
+	std::ifstream file(entryPath(key).c_str(), std::ios::binary);
+	ProgramCacheHeader header;
+	if (!file || !file.read((char *)&header, sizeof(header))
+		|| std::memcmp(header.magic, PROGRAM_CACHE_MAGIC, sizeof(header.magic)) != 0
+		|| header.version != PROGRAM_CACHE_VERSION || header.key != key)
+	{
+		misses++;
+		return false;
+	}
+
+	std::vector<char> binary(header.length);
+	if (!file.read(binary.data(), binary.size()))
+	{
+		misses++;
+		return false;
+	}
+
+	// The driver may still reject the binary, e.g. after an update that kept the version string
+	glProgramBinary(program, header.format, binary.data(), header.length);
+	int success;
+	glGetProgramiv(program, GL_LINK_STATUS, &success);
+	if (!success)
+	{
+		misses++;
+		return false;
+	}
+	hits++;
+	return true;
+}
+
+void ProgramCache::store(unsigned long long key, unsigned int program)
+{
+	if (!enabled)
+		return;
+
+	GLint length = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0)
+		return;
+
+	std::vector<char> binary(length);
+	GLenum format = 0;
+	glGetProgramBinary(program, length, NULL, &format, binary.data());
+
+	ProgramCacheHeader header;
+	std::memcpy(header.magic, PROGRAM_CACHE_MAGIC, sizeof(header.magic));
+	header.version = PROGRAM_CACHE_VERSION;
+	header.key = key;
+	header.format = format;
+	header.length = (unsigned int)length;
+
+	std::ofstream file(entryPath(key).c_str(), std::ios::binary | std::ios::trunc);
+	if (!file.write((const char *)&header, sizeof(header)) || !file.write(binary.data(), binary.size()))
+		std::cout << "ERROR::PROGRAM_CACHE::CANNOT_WRITE " << entryPath(key) << std::endl;
+}
+
+void ProgramCache::report() const
+{
+	if (enabled)
+		std::cout << "Program cache: " << hits << " hits, " << misses << " misses (" << directory << ")" << std::endl;
+}
@@ -0,0 +1,43 @@
+#ifndef PROGRAM_CACHE_H
+#define PROGRAM_CACHE_H
+
+#include <string>
+
+// On-disk cache of linked program binaries (glGetProgramBinary / glProgramBinary)
+// Entries are keyed by a hash of the GLSL sources plus the driver's vendor, renderer and version strings,
+// so a driver update or a shader edit simply misses and the program gets compiled again
+// ------------------------------------------------------------------------------------------------------
+class ProgramCache
+{
+public:
+	// Checks driver support and creates the cache directory, requires glad to be loaded
+	void init(const std::string &directory);
+
+	bool isEnabled() const { return enabled; }
+
+	// Key identifying a vertex + fragment source pair on the current driver
+	unsigned long long computeKey(const char *vertexSource, const char *fragmentSource) const;
+
+	// Loads a stored binary into program, returns false (and counts a miss) if it is absent or rejected by the driver
+	bool load(unsigned long long key, unsigned int program);
+
+	// Stores the binary of a freshly linked program, it must have been linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+	void store(unsigned long long key, unsigned int program);
+
+	unsigned int getHits() const { return hits; }
+	unsigned int getMisses() const { return misses; }
+
+	// Prints hit/miss counters
+	void report() const;
+
+private:
+	std::string entryPath(unsigned long long key) const;
+
+	std::string directory;
+	std::string driverId;
+	bool enabled = false;
+	unsigned int hits = 0;
+	unsigned int misses = 0;
+};
+
+#endif
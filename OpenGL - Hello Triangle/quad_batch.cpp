@@ -0,0 +1,127 @@
+#include <glad/glad.h>
+
+#include "gl_state.h"
+#include "quad_batch.h"
+#include "vertex_format.h"
+
+#include <cstddef>
+
+// Position only, same layout as the quad in main.cpp
+static const size_t QUAD_VERTEX_STRIDE = 3 * sizeof(float);
+static const size_t QUAD_BYTES = 4 * QUAD_VERTEX_STRIDE;
+
+void QuadBatch::init(unsigned int maxQuadsPerDraw, unsigned int expectedQuadsPerFrame)
+{
+	maxQuads = maxQuadsPerDraw;
+
+	glGenVertexArrays(1, &VAO);
+	glGenBuffers(1, &EBO);
+	glState.bindVertexArray(VAO);
+
+	// Every quad uses the same index pattern, so the index buffer is written once
+	// Corners are top right, bottom right, bottom left, top left as in vertices[] in main.cpp
+	// Draws rebase with a base vertex, so indices only have to address one draw's quads
+	std::vector<unsigned int> indices(maxQuads * 6);
+	for (unsigned int quad = 0; quad < maxQuads; quad++)
+	{
+		unsigned int base = quad * 4;
+		unsigned int *index = &indices[quad * 6];
+		index[0] = base + 0; index[1] = base + 2; index[2] = base + 3;
+		index[3] = base + 0; index[4] = base + 1; index[5] = base + 2;
+	}
+	unsigned int indexSize = chooseIndexSize(maxQuads * 4);
+	indexType = getIndexType(indexSize);
+	std::vector<unsigned char> packedIndices;
+	packIndices(indices.data(), indices.size(), indexSize, packedIndices);
+	glState.bindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, packedIndices.size(), packedIndices.data(), GL_STATIC_DRAW);
+
+	// Attribute 0 reads from the start of the stream buffer, draws pick their region with a base vertex
+	unsigned int quadsPerRegion = expectedQuadsPerFrame > maxQuads ? expectedQuadsPerFrame : maxQuads;
+	vertexStream.init(GL_ARRAY_BUFFER, quadsPerRegion * QUAD_BYTES + QUAD_VERTEX_STRIDE);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, QUAD_VERTEX_STRIDE, (void*)0);
+	glEnableVertexAttribArray(0);
+
+	glState.bindVertexArray(0);
+}
+
+void QuadBatch::destroy()
+{
+	vertexStream.destroy();
+	glState.deleteVertexArrays(1, &VAO);
+	glState.deleteBuffers(1, &EBO);
+	VAO = EBO = 0;
+	buckets.clear();
+}
+
+void QuadBatch::begin()
+{
+	stats = QuadBatchStats();
+}
+
+QuadBatch::Bucket &QuadBatch::findBucket(unsigned int material)
+{
+	// Scenes use a handful of materials, a linear search beats hashing here
+	for (size_t i = 0; i < buckets.size(); i++)
+		if (buckets[i].material == material)
+			return buckets[i];
+
+	buckets.push_back(Bucket());
+	Bucket &bucket = buckets.back();
+	bucket.material = material;
+	bucket.quads = 0;
+	bucket.rects.reserve(maxQuads * 4);
+	return bucket;
+}
+
+void QuadBatch::submit(unsigned int material, float x, float y, float width, float height)
+{
+	Bucket &bucket = findBucket(material);
+	if (bucket.quads == maxQuads)
+		flush(bucket);
+
+	float rect[4] = { x, y, width, height };
+	bucket.rects.insert(bucket.rects.end(), rect, rect + 4);
+	bucket.quads++;
+	stats.quads++;
+}
+
+void QuadBatch::end()
+{
+	for (size_t i = 0; i < buckets.size(); i++)
+		if (buckets[i].quads)
+			flush(buckets[i]);
+	vertexStream.endFrame();
+}
+
+void QuadBatch::flush(Bucket &bucket)
+{
+	size_t bytes = bucket.quads * QUAD_BYTES;
+	size_t offset = 0;
+	float *vertex = (float *)vertexStream.allocate(bytes, QUAD_VERTEX_STRIDE, offset);
+	if (vertex)
+	{
+		// Expand each rect into its four corners directly in the mapped buffer
+		const float *rect = bucket.rects.data();
+		for (unsigned int quad = 0; quad < bucket.quads; quad++, rect += 4, vertex += 12)
+		{
+			float left = rect[0];
+			float bottom = rect[1];
+			float right = rect[0] + rect[2];
+			float top = rect[1] + rect[3];
+			vertex[0] = right; vertex[1] = top; vertex[2] = 0.0f;
+			vertex[3] = right; vertex[4] = bottom; vertex[5] = 0.0f;
+			vertex[6] = left; vertex[7] = bottom; vertex[8] = 0.0f;
+			vertex[9] = left; vertex[10] = top; vertex[11] = 0.0f;
+		}
+		vertexStream.commit(offset, bytes);
+
+		glState.useProgram(bucket.material);
+		glState.bindVertexArray(VAO);
+		glDrawElementsBaseVertex(GL_TRIANGLES, bucket.quads * 6, indexType, 0, (GLint)(offset / QUAD_VERTEX_STRIDE));
+		stats.draws++;
+	}
+
+	bucket.rects.clear();
+	bucket.quads = 0;
+}
@@ -0,0 +1,66 @@
+#ifndef QUAD_BATCH_H
+#define QUAD_BATCH_H
+
+#include "stream_buffer.h"
+
+#include <vector>
+
+// Per-frame batching counters
+// ---------------------------
+struct QuadBatchStats
+{
+	unsigned int quads = 0;
+	unsigned int draws = 0;
+};
+
+// Accumulates axis-aligned quads into a compact CPU-side staging array per material
+// and draws each material's quads with a single glDrawElementsBaseVertex
+// Vertices are expanded straight into a persistently mapped StreamBuffer on flush and the
+// index buffer never changes, so nothing is copied by the driver
+// A material that reaches the batch size is flushed early, costing one extra draw
+// ---------------------------------------------------------------------------------------
+class QuadBatch
+{
+public:
+	// Creates the VAO and buffers for up to maxQuadsPerDraw quads per draw, sizing the streaming
+	// regions so a frame of expectedQuadsPerFrame quads fits in one of them. Requires glad to be loaded
+	void init(unsigned int maxQuadsPerDraw, unsigned int expectedQuadsPerFrame);
+	void destroy();
+
+	// Starts a new frame, resetting the counters
+	void begin();
+
+	// Queues a quad covering [x, x + width] x [y, y + height] in normalized device coordinates
+	// The material is the shader program it is drawn with
+	void submit(unsigned int material, float x, float y, float width, float height);
+
+	// Draws everything still queued and fences this frame's vertex data
+	void end();
+
+	const QuadBatchStats &getStats() const { return stats; }
+	const StreamBuffer &getStreamBuffer() const { return vertexStream; }
+
+private:
+	struct Bucket
+	{
+		unsigned int material;
+		unsigned int quads;
+		// x, y, width, height per quad
+		std::vector<float> rects;
+	};
+
+	Bucket &findBucket(unsigned int material);
+	void flush(Bucket &bucket);
+
+	unsigned int VAO = 0;
+	unsigned int EBO = 0;
+	unsigned int maxQuads = 0;
+	// GL type of the shared index buffer, 16-bit while a draw's quads fit in 65536 vertices
+	unsigned int indexType = 0;
+	StreamBuffer vertexStream;
+
+	std::vector<Bucket> buckets;
+	QuadBatchStats stats;
+};
+
+#endif
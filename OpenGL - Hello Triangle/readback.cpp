@@ -0,0 +1,263 @@
+#include <glad/glad.h>
+
+#include "gl_state.h"
+#include "readback.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+static double nowMs()
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// PPM files
+// ---------
+bool writePPM(const std::string &path, const Image &image)
+{
+	std::ofstream file(path.c_str(), std::ios::binary);
+	if (!file)
+		return false;
+	file << "P6\n" << image.width << " " << image.height << "\n255\n";
+
+	std::vector<unsigned char> row(image.width * 3);
+	for (unsigned int y = 0; y < image.height; y++)
+	{
+		// Flip so the file starts with the top row
+		const unsigned char *src = &image.rgba[(size_t)(image.height - 1 - y) * image.width * 4];
+		for (unsigned int x = 0; x < image.width; x++)
+		{
+			row[x * 3 + 0] = src[x * 4 + 0];
+			row[x * 3 + 1] = src[x * 4 + 1];
+			row[x * 3 + 2] = src[x * 4 + 2];
+		}
+		file.write((const char *)row.data(), row.size());
+	}
+	return (bool)file;
+}
+
+// Reads the next whitespace separated header token, skipping # comments
+static bool readHeaderToken(std::ifstream &file, std::string &token)
+{
+	token.clear();
+	char c;
+	while (file.get(c))
+	{
+		if (c == '#')
+		{
+			while (file.get(c) && c != '\n')
+				;
+			continue;
+		}
+		if (c == ' ' || c == '\t' || c == '\r' || c == '\n')
+		{
+			if (!token.empty())
+				return true;
+			continue;
+		}
+		token += c;
+	}
+	return !token.empty();
+}
+
+bool readPPM(const std::string &path, Image &image)
+{
+	std::ifstream file(path.c_str(), std::ios::binary);
+	std::string magic, width, height, maxValue;
+	if (!file || !readHeaderToken(file, magic) || magic != "P6" || !readHeaderToken(file, width)
+		|| !readHeaderToken(file, height) || !readHeaderToken(file, maxValue) || maxValue != "255")
+		return false;
+
+	// The whitespace after the max value was consumed with it, the pixels start here
+	std::streamoff pixelStart = file.tellg();
+	file.seekg(0, std::ios::end);
+	std::streamoff remaining = file.tellg() - pixelStart;
+	file.seekg(pixelStart);
+
+	// Bound the dimensions by the pixel data actually present before allocating anything
+	unsigned long long w = std::strtoull(width.c_str(), NULL, 10);
+	unsigned long long h = std::strtoull(height.c_str(), NULL, 10);
+	if (w == 0 || h == 0 || remaining < 0 || w > (unsigned long long)remaining / 3 / h)
+		return false;
+	image.width = (unsigned int)w;
+	image.height = (unsigned int)h;
+	image.rgba.resize((size_t)image.width * image.height * 4);
+
+	std::vector<unsigned char> row((size_t)image.width * 3);
+	for (unsigned int y = 0; y < image.height; y++)
+	{
+		if (!file.read((char *)row.data(), row.size()))
+			return false;
+		unsigned char *dst = &image.rgba[(size_t)(image.height - 1 - y) * image.width * 4];
+		for (unsigned int x = 0; x < image.width; x++)
+		{
+			dst[x * 4 + 0] = row[x * 3 + 0];
+			dst[x * 4 + 1] = row[x * 3 + 1];
+			dst[x * 4 + 2] = row[x * 3 + 2];
+			dst[x * 4 + 3] = 255;
+		}
+	}
+	return true;
+}
+
+ImageDiff compareImages(const Image &actual, const Image &expected, unsigned int tolerance)
+{
+	ImageDiff diff;
+	diff.sameSize = actual.width == expected.width && actual.height == expected.height;
+	if (!diff.sameSize)
+		return diff;
+
+	size_t pixels = (size_t)actual.width * actual.height;
+	for (size_t i = 0; i < pixels; i++)
+	{
+		unsigned int pixelMax = 0;
+		for (int c = 0; c < 3; c++)
+		{
+			int delta = (int)actual.rgba[i * 4 + c] - (int)expected.rgba[i * 4 + c];
+			unsigned int magnitude = (unsigned int)(delta < 0 ? -delta : delta);
+			if (magnitude > pixelMax)
+				pixelMax = magnitude;
+		}
+		if (pixelMax > diff.maxDifference)
+			diff.maxDifference = pixelMax;
+		if (pixelMax > tolerance)
+			diff.mismatchedPixels++;
+	}
+	return diff;
+}
+
+// Asynchronous readback
+// ---------------------
+void AsyncReadback::init()
+{
+	for (unsigned int i = 0; i < RING_SIZE; i++)
+	{
+		glGenBuffers(1, &slots[i].PBO);
+		slots[i].capacity = 0;
+		slots[i].fence = NULL;
+	}
+	next = 0;
+	inFlight = 0;
+}
+
+void AsyncReadback::destroy()
+{
+	for (unsigned int i = 0; i < RING_SIZE; i++)
+	{
+		if (slots[i].fence)
+			glDeleteSync((GLsync)slots[i].fence);
+		glState.deleteBuffers(1, &slots[i].PBO);
+		slots[i] = Slot();
+	}
+	inFlight = 0;
+	done.clear();
+}
+
+void AsyncReadback::request(unsigned int width, unsigned int height, unsigned int frame)
+{
+	Slot &slot = slots[next];
+	if (slot.fence)
+	{
+		// Every buffer is still in flight, the oldest one has to be finished first
+		if (!finish(slot, false))
+		{
+			stalls++;
+			finish(slot, true);
+		}
+	}
+
+	size_t size = (size_t)width * height * 4;
+	glState.bindBuffer(GL_PIXEL_PACK_BUFFER, slot.PBO);
+	if (size > slot.capacity)
+	{
+		glBufferData(GL_PIXEL_PACK_BUFFER, size, NULL, GL_STREAM_READ);
+		slot.capacity = size;
+	}
+
+	// With a pack buffer bound the pointer argument is an offset and the call doesn't wait
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, (void*)0);
+	glState.bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	slot.width = width;
+	slot.height = height;
+	slot.frame = frame;
+	slot.requestTime = nowMs();
+
+	next = (next + 1) % RING_SIZE;
+	inFlight++;
+}
+
+void AsyncReadback::poll(bool wait)
+{
+	// Slots finish in request order, starting with the oldest
+	while (inFlight > 0)
+	{
+		Slot &slot = slots[(next + RING_SIZE - inFlight) % RING_SIZE];
+		if (!finish(slot, wait))
+			break;
+	}
+}
+
+bool AsyncReadback::pop(Image &image)
+{
+	if (done.empty())
+		return false;
+	image.width = done.front().width;
+	image.height = done.front().height;
+	image.frame = done.front().frame;
+	image.rgba.swap(done.front().rgba);
+	done.pop_front();
+	return true;
+}
+
+bool AsyncReadback::finish(Slot &slot, bool wait)
+{
+	GLsync fence = (GLsync)slot.fence;
+	GLenum result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+	while (wait && result == GL_TIMEOUT_EXPIRED)
+		result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+	if (result == GL_TIMEOUT_EXPIRED)
+		return false;
+	glDeleteSync(fence);
+	slot.fence = NULL;
+	inFlight--;
+	// The slot is free again either way, but a failed wait leaves its contents unknown: drop the frame
+	if (result == GL_WAIT_FAILED)
+	{
+		std::cout << "ERROR::READBACK::WAIT_FAILED frame " << slot.frame << std::endl;
+		return true;
+	}
+
+	// The copy has completed, mapping now is just a memory copy
+	double copyStart = nowMs();
+	size_t size = (size_t)slot.width * slot.height * 4;
+	Image image;
+	image.width = slot.width;
+	image.height = slot.height;
+	image.frame = slot.frame;
+	image.rgba.resize(size);
+	glState.bindBuffer(GL_PIXEL_PACK_BUFFER, slot.PBO);
+	void *data = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, size, GL_MAP_READ_BIT);
+	if (!data)
+	{
+		glState.bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		std::cout << "ERROR::READBACK::MAP_FAILED frame " << slot.frame << std::endl;
+		return true;
+	}
+	std::memcpy(image.rgba.data(), data, size);
+	glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+	glState.bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	double copyEnd = nowMs();
+
+	completed++;
+	totalLatencyMs += copyEnd - slot.requestTime;
+	totalCopyMs += copyEnd - copyStart;
+	totalBytes += (double)size;
+	done.push_back(image);
+	return true;
+}
@@ -0,0 +1,91 @@
+#ifndef READBACK_H
+#define READBACK_H
+
+#include <deque>
+#include <string>
+#include <vector>
+
+// RGBA8 image, row 0 is the bottom row as glReadPixels returns it
+// ---------------------------------------------------------------
+struct Image
+{
+	unsigned int width = 0;
+	unsigned int height = 0;
+	// Frame the image was captured after, 1-based
+	unsigned int frame = 0;
+	std::vector<unsigned char> rgba;
+};
+
+// Binary PPM (P6) files, written top row first; alpha is dropped on write and set to 255 on read
+bool writePPM(const std::string &path, const Image &image);
+bool readPPM(const std::string &path, Image &image);
+
+// Result of comparing two images channel by channel (alpha ignored)
+struct ImageDiff
+{
+	bool sameSize = false;
+	unsigned int maxDifference = 0;
+	// Pixels with a channel differing by more than the tolerance
+	unsigned int mismatchedPixels = 0;
+};
+
+ImageDiff compareImages(const Image &actual, const Image &expected, unsigned int tolerance);
+
+// Reads the current read framebuffer back through a ring of pixel pack buffers
+// glReadPixels into a bound GL_PIXEL_PACK_BUFFER returns immediately; a fence tells when the copy has
+// landed, so the buffer is only mapped once the data is there and the render loop never stalls on it
+// ---------------------------------------------------------------------------------------------------
+class AsyncReadback
+{
+public:
+	static const unsigned int RING_SIZE = 3;
+
+	// Creates the pixel buffers, requires glad to be loaded
+	void init();
+	void destroy();
+
+	// Queues a readback of the lower-left width x height pixels of the current read framebuffer
+	// If every buffer is in flight the oldest one is waited for, which counts as a stall
+	void request(unsigned int width, unsigned int height, unsigned int frame);
+
+	// Moves finished readbacks to the completed queue, blocking on all of them if wait is set
+	void poll(bool wait);
+
+	// Takes the oldest completed image, returns false when there is none
+	bool pop(Image &image);
+
+	bool hasPending() const { return inFlight > 0; }
+
+	unsigned int getCompleted() const { return completed; }
+	unsigned int getStalls() const { return stalls; }
+	// Mean time from request to mapped data, and throughput of the map + copy
+	double getMeanLatencyMs() const { return completed ? totalLatencyMs / completed : 0.0; }
+	double getCopyMBps() const { return totalCopyMs > 0.0 ? totalBytes / 1.0e3 / totalCopyMs : 0.0; }
+
+private:
+	struct Slot
+	{
+		unsigned int PBO;
+		size_t capacity;
+		void *fence;
+		unsigned int width;
+		unsigned int height;
+		unsigned int frame;
+		double requestTime;
+	};
+
+	bool finish(Slot &slot, bool wait);
+
+	Slot slots[RING_SIZE] = {};
+	unsigned int next = 0;
+	unsigned int inFlight = 0;
+	std::deque<Image> done;
+
+	unsigned int completed = 0;
+	unsigned int stalls = 0;
+	double totalLatencyMs = 0.0;
+	double totalCopyMs = 0.0;
+	double totalBytes = 0.0;
+};
+
+#endif
@@ -0,0 +1,177 @@
+#include <glad/glad.h>
+
+#include "command_buffer.h"
+#include "gl_state.h"
+#include "render_queue.h"
+#include "vertex_format.h"
+
+#include <cstring>
+
+static const unsigned int PROGRAM_BITS = 12;
+static const unsigned int VERTEX_ARRAY_BITS = 12;
+static const unsigned int TEXTURE_BITS = 16;
+static const unsigned int DEPTH_BITS = 24;
+
+// Names are looked up in a table indexed by name; drivers hand out small, dense names,
+// anything larger than this just shares the last rank
+static const unsigned int MAX_RANKED_NAME = 1 << 20;
+
+// Rank of name within a field of the given width, assigning the next free one on first use
+static unsigned int rankOf(std::vector<unsigned int> &ranks, unsigned int &count, unsigned int name, unsigned int bits)
+{
+	unsigned int limit = (1u << bits) - 1;
+	if (name >= MAX_RANKED_NAME)
+		return limit;
+	if (name >= ranks.size())
+		ranks.resize(name + 1, 0);
+	if (ranks[name] == 0)
+		ranks[name] = ++count;
+	unsigned int rank = ranks[name] - 1;
+	return rank < limit ? rank : limit;
+}
+
+void RenderQueue::clear()
+{
+	items.clear();
+	order.clear();
+}
+
+void RenderQueue::reserve(size_t count)
+{
+	items.reserve(count);
+	order.reserve(count);
+	scratch.reserve(count);
+}
+
+uint64_t RenderQueue::makeKey(const DrawItem &item)
+{
+	uint64_t program = rankOf(programRanks, programCount, item.program, PROGRAM_BITS);
+	uint64_t vertexArray = rankOf(vertexArrayRanks, vertexArrayCount, item.vertexArray, VERTEX_ARRAY_BITS);
+	uint64_t texture = rankOf(textureRanks, textureCount, item.texture, TEXTURE_BITS);
+
+	float depth = item.depth < 0.0f ? 0.0f : (item.depth > 1.0f ? 1.0f : item.depth);
+	uint64_t depthBits = (uint64_t)(depth * (float)((1u << DEPTH_BITS) - 1));
+
+	return (program << (VERTEX_ARRAY_BITS + TEXTURE_BITS + DEPTH_BITS))
+		| (vertexArray << (TEXTURE_BITS + DEPTH_BITS))
+		| (texture << DEPTH_BITS)
+		| depthBits;
+}
+
+void RenderQueue::push(const DrawItem &item)
+{
+	SortEntry entry;
+	entry.key = sorting ? makeKey(item) : 0;
+	entry.item = (unsigned int)items.size();
+	items.push_back(item);
+	order.push_back(entry);
+}
+
+void RenderQueue::sort()
+{
+	size_t count = order.size();
+	if (!sorting || count < 2)
+		return;
+	scratch.resize(count);
+
+	// One histogram per byte, all built in a single pass over the keys
+	static const unsigned int PASSES = 8;
+	unsigned int histograms[PASSES][256];
+	std::memset(histograms, 0, sizeof(histograms));
+	for (size_t i = 0; i < count; i++)
+	{
+		uint64_t key = order[i].key;
+		for (unsigned int pass = 0; pass < PASSES; pass++)
+			histograms[pass][(key >> (pass * 8)) & 0xFF]++;
+	}
+
+	SortEntry *source = order.data();
+	SortEntry *destination = scratch.data();
+	for (unsigned int pass = 0; pass < PASSES; pass++)
+	{
+		unsigned int *histogram = histograms[pass];
+		// A byte every key shares doesn't change the order
+		if (histogram[(source[0].key >> (pass * 8)) & 0xFF] == count)
+			continue;
+
+		unsigned int offset = 0;
+		for (unsigned int bucket = 0; bucket < 256; bucket++)
+		{
+			unsigned int bucketSize = histogram[bucket];
+			histogram[bucket] = offset;
+			offset += bucketSize;
+		}
+		for (size_t i = 0; i < count; i++)
+			destination[histogram[(source[i].key >> (pass * 8)) & 0xFF]++] = source[i];
+
+		SortEntry *swap = source;
+		source = destination;
+		destination = swap;
+	}
+
+	// After an odd number of executed passes the result is in scratch
+	if (source != order.data())
+		order.swap(scratch);
+}
+
+void RenderQueue::submit() const
+{
+	for (size_t i = 0; i < order.size(); i++)
+	{
+		const DrawItem &item = items[order[i].item];
+		glState.useProgram(item.program);
+		glState.bindVertexArray(item.vertexArray);
+		if (item.texture)
+		{
+			glState.activeTexture(GL_TEXTURE0);
+			glState.bindTexture(GL_TEXTURE_2D, item.texture);
+		}
+		glVertexAttrib3f(INSTANCE_OFFSET_SCALE_LOCATION, item.instance.offset[0], item.instance.offset[1], item.instance.scale);
+		glVertexAttrib4fv(INSTANCE_COLOR_LOCATION, item.instance.color);
+		glDrawElements(GL_TRIANGLES, item.indexCount, getIndexType(item.indexSize), 0);
+	}
+	if (!order.empty())
+		setDefaultInstanceAttributes();
+}
+
+void RenderQueue::record(CommandBuffer &buffer, size_t first, size_t last) const
+{
+	// Repeated binds within the range are left out here, execute() filters the rest through glState
+	const DrawItem *previous = NULL;
+	for (size_t i = first; i < last && i < order.size(); i++)
+	{
+		const DrawItem &item = items[order[i].item];
+		if (!previous || previous->program != item.program)
+			buffer.bindProgram(item.program);
+		if (!previous || previous->vertexArray != item.vertexArray)
+			buffer.bindVertexArray(item.vertexArray);
+		if (item.texture && (!previous || previous->texture != item.texture))
+			buffer.bindTexture(GL_TEXTURE0, GL_TEXTURE_2D, item.texture);
+		buffer.setInstance(item.instance);
+		buffer.drawElements(item.indexCount, getIndexType(item.indexSize), 0, 0);
+		previous = &item;
+	}
+}
+
+RenderQueueStats RenderQueue::countStateChanges() const
+{
+	RenderQueueStats stats;
+	const DrawItem *previous = NULL;
+	unsigned int boundTexture = 0;
+	for (size_t i = 0; i < order.size(); i++)
+	{
+		const DrawItem &item = items[order[i].item];
+		if (!previous || previous->program != item.program)
+			stats.programChanges++;
+		if (!previous || previous->vertexArray != item.vertexArray)
+			stats.vertexArrayChanges++;
+		// Items without a texture leave the previous one bound
+		if (item.texture && item.texture != boundTexture)
+		{
+			stats.textureChanges++;
+			boundTexture = item.texture;
+		}
+		previous = &item;
+	}
+	return stats;
+}
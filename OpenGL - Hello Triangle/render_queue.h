@@ -0,0 +1,97 @@
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#include "instancing.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class CommandBuffer;
+
+// One indexed draw and the state it needs
+// ---------------------------------------
+struct DrawItem
+{
+	unsigned int program = 0;
+	unsigned int vertexArray = 0;
+	// Bound to GL_TEXTURE_2D on unit 0, 0 leaves the unit alone
+	unsigned int texture = 0;
+	unsigned int indexCount = 0;
+	// Bytes per index of the VAO's element buffer, see chooseIndexSize()
+	unsigned int indexSize = 4;
+	// Normalized view depth, 0 is nearest; items sharing all state are drawn front to back
+	float depth = 0.0f;
+	// Set as generic attribute values, as InstancedRenderer::drawPerObject does
+	InstanceData instance = {};
+};
+
+// Number of times consecutive items switch each piece of state
+struct RenderQueueStats
+{
+	unsigned int programChanges = 0;
+	unsigned int vertexArrayChanges = 0;
+	unsigned int textureChanges = 0;
+};
+
+// Collects a frame's draw items and submits them in state-minimizing order
+// Each item gets a 64-bit key, most significant field first:
+//   program rank (12 bits) | VAO rank (12 bits) | texture rank (16 bits) | depth (24 bits)
+// Ranks are small numbers handed out in first-seen order and kept across frames. The keys are
+// LSD radix sorted, 8 bits per pass, skipping passes where every key has the same byte
+// Names past a field's range share its last rank, which only costs sort quality: submit() binds
+// through glState, so state is always correct
+// -----------------------------------------------------------------------------------------------
+class RenderQueue
+{
+public:
+	// Starts a new frame, forgetting the items but keeping the ranks and allocations
+	void clear();
+	void reserve(size_t count);
+
+	void push(const DrawItem &item);
+
+	// With sorting off items are submitted in push order, for comparison
+	void setSorting(bool enabled) { sorting = enabled; }
+
+	// Orders the items by key, call once all items of the frame are pushed
+	void sort();
+
+	// Binds state and draws every item in order, requires glad to be loaded
+	void submit() const;
+
+	// Records items [first, last) of the submission order as commands instead, without touching GL
+	// Disjoint ranges can be recorded from several threads at once
+	void record(CommandBuffer &buffer, size_t first, size_t last) const;
+
+	size_t size() const { return items.size(); }
+	// i-th item in submission order
+	const DrawItem &getItem(size_t i) const { return items[order[i].item]; }
+
+	// Counts the state switches submit() will make, without touching GL
+	RenderQueueStats countStateChanges() const;
+
+private:
+	struct SortEntry
+	{
+		uint64_t key;
+		unsigned int item;
+	};
+
+	uint64_t makeKey(const DrawItem &item);
+
+	std::vector<DrawItem> items;
+	std::vector<SortEntry> order;
+	std::vector<SortEntry> scratch;
+	bool sorting = true;
+
+	// Rank + 1 of every name seen so far, indexed by name; 0 means no rank yet
+	std::vector<unsigned int> programRanks;
+	std::vector<unsigned int> vertexArrayRanks;
+	std::vector<unsigned int> textureRanks;
+	unsigned int programCount = 0;
+	unsigned int vertexArrayCount = 0;
+	unsigned int textureCount = 0;
+};
+
+#endif
@@ -0,0 +1,145 @@
+#include <glad/glad.h>
+
+#include "shader.h"
+#include "cpu_trace.h"
+#include "program_cache.h"
+
+#include <iostream>
+
+// KHR_parallel_shader_compile / ARB_parallel_shader_compile share token values
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+void ShaderPipeline::init(ProgramCache *programCache)
+{
+	cache = programCache;
+	parallel = false;
+	if (GLAD_GL_KHR_parallel_shader_compile)
+	{
+		// 0xFFFFFFFF lets the implementation pick the number of compiler threads
+		glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+		parallel = true;
+	}
+	else if (GLAD_GL_ARB_parallel_shader_compile)
+	{
+		glMaxShaderCompilerThreadsARB(0xFFFFFFFF);
+		parallel = true;
+	}
+}
+
+unsigned int ShaderPipeline::submit(const char *vertexSource, const char *fragmentSource)
+{
+	CPU_TRACE_SCOPE("shader submit");
+	PendingProgram pending;
+	pending.vertexShader = 0;
+	pending.fragmentShader = 0;
+	pending.program = glCreateProgram();
+	pending.cacheKey = 0;
+	pending.ready = false;
+
+	// A cached binary is ready straight away
+	bool useCache = cache && cache->isEnabled();
+	if (useCache)
+	{
+		pending.cacheKey = cache->computeKey(vertexSource, fragmentSource);
+		if (cache->load(pending.cacheKey, pending.program))
+		{
+			pending.ready = true;
+			builds.push_back(pending);
+			return (unsigned int)builds.size() - 1;
+		}
+		// A rejected binary leaves the program object unusable, start from a fresh one
+		glDeleteProgram(pending.program);
+		pending.program = glCreateProgram();
+	}
+
+	// Kick off both compiles and the link without querying any status in between,
+	// a failed compile simply makes the link fail and is diagnosed in complete()
+	pending.vertexShader = glCreateShader(GL_VERTEX_SHADER);
+	glShaderSource(pending.vertexShader, 1, &vertexSource, NULL);
+	glCompileShader(pending.vertexShader);
+
+	pending.fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+	glShaderSource(pending.fragmentShader, 1, &fragmentSource, NULL);
+	glCompileShader(pending.fragmentShader);
+
+	if (useCache)
+		glProgramParameteri(pending.program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	glAttachShader(pending.program, pending.vertexShader);
+	glAttachShader(pending.program, pending.fragmentShader);
+	glLinkProgram(pending.program);
+
+	builds.push_back(pending);
+	return (unsigned int)builds.size() - 1;
+}
+
+bool ShaderPipeline::isReady(unsigned int handle)
+{
+	PendingProgram &pending = builds[handle];
+	if (pending.ready)
+		return true;
+
+	if (parallel)
+	{
+		int completed = GL_FALSE;
+		glGetProgramiv(pending.program, GL_COMPLETION_STATUS_KHR, &completed);
+		if (!completed)
+			return false;
+	}
+	complete(pending);
+	return true;
+}
+
+unsigned int ShaderPipeline::getProgram(unsigned int handle) const
+{
+	const PendingProgram &pending = builds[handle];
+	return pending.ready ? pending.program : 0;
+}
+
+void ShaderPipeline::finishAll()
+{
+	for (size_t i = 0; i < builds.size(); i++)
+		if (!builds[i].ready)
+			complete(builds[i]);
+}
+
+void ShaderPipeline::complete(PendingProgram &pending)
+{
+	CPU_TRACE_SCOPE("shader link");
+	int success;
+	char infoLog[512];
+	glGetProgramiv(pending.program, GL_LINK_STATUS, &success);
+	if (!success)
+	{
+		// Report the stage that failed, falling back to the linker's log
+		unsigned int stages[2] = { pending.vertexShader, pending.fragmentShader };
+		const char *stageNames[2] = { "VERTEX", "FRAGMENT" };
+		bool compileFailed = false;
+		for (int i = 0; i < 2; i++)
+		{
+			glGetShaderiv(stages[i], GL_COMPILE_STATUS, &success);
+			if (!success)
+			{
+				glGetShaderInfoLog(stages[i], 512, NULL, infoLog);
+				std::cout << "ERROR::SHADER::" << stageNames[i] << "::COMPILATION_FAILED\n" << infoLog << std::endl;
+				compileFailed = true;
+			}
+		}
+		if (!compileFailed)
+		{
+			glGetProgramInfoLog(pending.program, 512, NULL, infoLog);
+			std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
+		}
+		glDeleteProgram(pending.program);
+		pending.program = 0;
+	}
+	else if (cache && cache->isEnabled())
+		cache->store(pending.cacheKey, pending.program);
+
+	glDeleteShader(pending.vertexShader);
+	glDeleteShader(pending.fragmentShader);
+	pending.vertexShader = 0;
+	pending.fragmentShader = 0;
+	pending.ready = true;
+}
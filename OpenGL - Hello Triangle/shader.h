@@ -0,0 +1,51 @@
+#ifndef SHADER_H
+#define SHADER_H
+
+#include <cstddef>
+#include <vector>
+
+class ProgramCache;
+
+// Builds programs without blocking the render loop
+// All compiles and links are submitted up front; with KHR_parallel_shader_compile the driver runs them on
+// its own threads and GL_COMPLETION_STATUS_KHR tells when a program can be queried without stalling
+// Without the extension the first status query after submission blocks, so poll after drawing a frame
+// --------------------------------------------------------------------------------------------------------
+class ShaderPipeline
+{
+public:
+	// Enables driver compiler threads when available, requires glad to be loaded
+	void init(ProgramCache *cache);
+
+	bool isParallel() const { return parallel; }
+
+	// Queues compilation and linking of a program, returns a handle to poll
+	unsigned int submit(const char *vertexSource, const char *fragmentSource);
+
+	// True once the build has finished (successfully or not), never blocks with the extension
+	bool isReady(unsigned int handle);
+
+	// Linked program, 0 while pending or when the build failed
+	unsigned int getProgram(unsigned int handle) const;
+
+	// Blocks until every submitted build has finished
+	void finishAll();
+
+private:
+	struct PendingProgram
+	{
+		unsigned int vertexShader;
+		unsigned int fragmentShader;
+		unsigned int program;
+		unsigned long long cacheKey;
+		bool ready;
+	};
+
+	void complete(PendingProgram &pending);
+
+	ProgramCache *cache = NULL;
+	bool parallel = false;
+	std::vector<PendingProgram> builds;
+};
+
+#endif
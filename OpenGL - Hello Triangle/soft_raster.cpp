@@ -0,0 +1,377 @@
+#include "soft_raster.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SOFT_RASTER_SSE2
+#include <emmintrin.h>
+#endif
+
+// Vertices are snapped to 1/16 pixel
+static const int SUBPIXEL_BITS = 4;
+static const int SUBPIXEL_ONE = 1 << SUBPIXEL_BITS;
+static const int SUBPIXEL_HALF = SUBPIXEL_ONE / 2;
+
+// Edge functions of triangles up to this extent (in subpixels) fit in 32 bits over their bounding box,
+// larger ones are rasterized with the 64-bit scalar path
+static const int NARROW_EXTENT = 30000;
+
+void SoftFramebuffer::resize(unsigned int newWidth, unsigned int newHeight)
+{
+	width = newWidth;
+	height = newHeight;
+	pitch = (width + 7) & ~7u;
+	pixels.assign((size_t)pitch * height, 0);
+}
+
+static unsigned int packColor(const float color[4])
+{
+	unsigned int packed = 0;
+	for (int i = 0; i < 4; i++)
+	{
+		float c = std::min(std::max(color[i], 0.0f), 1.0f);
+		packed |= (unsigned int)(c * 255.0f + 0.5f) << (8 * i);
+	}
+	return packed;
+}
+
+void SoftFramebuffer::clear(const float color[4])
+{
+	std::fill(pixels.begin(), pixels.end(), packColor(color));
+}
+
+void SoftFramebuffer::copyTo(std::vector<unsigned char> &rgba) const
+{
+	rgba.resize((size_t)width * height * 4);
+	for (unsigned int y = 0; y < height; y++)
+		for (unsigned int x = 0; x < width; x++)
+		{
+			unsigned int pixel = pixels[(size_t)y * pitch + x];
+			unsigned char *out = &rgba[((size_t)y * width + x) * 4];
+			out[0] = pixel & 0xFF;
+			out[1] = (pixel >> 8) & 0xFF;
+			out[2] = (pixel >> 16) & 0xFF;
+			out[3] = pixel >> 24;
+		}
+}
+
+unsigned long long SoftFramebuffer::hash() const
+{
+	unsigned long long hash = 14695981039346656037ULL;
+	for (unsigned int y = 0; y < height; y++)
+		for (unsigned int x = 0; x < width; x++)
+		{
+			unsigned int pixel = pixels[(size_t)y * pitch + x];
+			for (int byte = 0; byte < 4; byte++)
+			{
+				hash ^= (pixel >> (8 * byte)) & 0xFF;
+				hash *= 1099511628211ULL;
+			}
+		}
+	return hash;
+}
+
+// Shaders
+// -------
+void softVertexShader(const float aPos[3], const InstanceData &instance, SoftVertex &out)
+{
+	// gl_Position = vec4(aPos.xy * aOffsetScale.z + aOffsetScale.xy, aPos.z, 1.0)
+	out.position[0] = aPos[0] * instance.scale + instance.offset[0];
+	out.position[1] = aPos[1] * instance.scale + instance.offset[1];
+	out.position[2] = aPos[2];
+	out.position[3] = 1.0f;
+	// vColor = aColor
+	for (int i = 0; i < 4; i++)
+		out.color[i] = instance.color[i];
+}
+
+void softFragmentShader(const float vColor[4], float fragColor[4])
+{
+	// FragColor = vColor
+	for (int i = 0; i < 4; i++)
+		fragColor[i] = vColor[i];
+}
+
+static int floorDiv(long long value, int divisor)
+{
+	long long quotient = value / divisor;
+	if ((value % divisor != 0) && ((value < 0) != (divisor < 0)))
+		quotient--;
+	return (int)quotient;
+}
+
+void SoftRasterizer::init(unsigned int width, unsigned int height, unsigned int threads)
+{
+	jobs.init(threads);
+	threadCount = jobs.getThreadCount();
+	framebuffer.resize(width, height);
+	tilesX = (width + TILE_SIZE - 1) / TILE_SIZE;
+	tilesY = (height + TILE_SIZE - 1) / TILE_SIZE;
+	bins.assign(threadCount, std::vector<std::vector<unsigned int> >(tilesX * tilesY));
+}
+
+const char *SoftRasterizer::simdPath()
+{
+#if defined(__AVX2__)
+	return "AVX2";
+#elif defined(SOFT_RASTER_SSE2)
+	return "SSE2";
+#else
+	return "scalar";
+#endif
+}
+
+void SoftRasterizer::clear(const float color[4])
+{
+	framebuffer.clear(color);
+}
+
+void SoftRasterizer::drawElementsInstanced(const float *positions, unsigned int vertexCount, const unsigned int *indices,
+	unsigned int indexCount, const InstanceData *instances, unsigned int instanceCount)
+{
+	unsigned int trianglesPerInstance = indexCount / 3;
+	unsigned int triangleCount = trianglesPerInstance * instanceCount;
+	transformed.resize((size_t)vertexCount * instanceCount);
+	triangles.resize(triangleCount);
+
+	// Vertex shading, triangle setup and binning, one contiguous range of instances per bin set
+	// The ranges are fixed by the thread count, not by which worker runs them, so the bins are deterministic
+	jobs.parallelFor(threadCount, 1, [&](size_t firstRange, size_t lastRange) {
+		for (unsigned int range = (unsigned int)firstRange; range < lastRange; range++)
+		{
+			unsigned int first = (unsigned int)((unsigned long long)instanceCount * range / threadCount);
+			unsigned int last = (unsigned int)((unsigned long long)instanceCount * (range + 1) / threadCount);
+			for (unsigned int instance = first; instance < last; instance++)
+			{
+				SoftVertex *out = &transformed[(size_t)instance * vertexCount];
+				for (unsigned int v = 0; v < vertexCount; v++)
+					softVertexShader(&positions[v * 3], instances[instance], out[v]);
+				for (unsigned int t = 0; t < trianglesPerInstance; t++)
+					setupTriangles(out, &indices[t * 3], instance * trianglesPerInstance + t, 1, triangles);
+			}
+			for (size_t tile = 0; tile < bins[range].size(); tile++)
+				bins[range][tile].clear();
+			binTriangles(range, first * trianglesPerInstance, last * trianglesPerInstance);
+		}
+	});
+
+	// Rasterization, workers pull tiles until none are left
+	std::atomic<unsigned int> nextTile(0);
+	unsigned int tileCount = tilesX * tilesY;
+	jobs.parallelFor(threadCount, 1, [&](size_t, size_t) {
+		for (unsigned int tile = nextTile++; tile < tileCount; tile = nextTile++)
+			rasterizeTile(tile);
+	});
+}
+
+void SoftRasterizer::setupTriangles(const SoftVertex *vertices, const unsigned int *triangleIndices, unsigned int first,
+	unsigned int count, std::vector<Triangle> &out) const
+{
+	for (unsigned int i = 0; i < count; i++)
+	{
+		Triangle &triangle = out[first + i];
+		triangle.minX = 1;
+		triangle.maxX = 0;
+
+		// Viewport transform and snapping; there is no clipper, so vertices behind the eye are dropped
+		long long X[3], Y[3];
+		const SoftVertex *corners[3];
+		bool visible = true;
+		for (int k = 0; k < 3; k++)
+		{
+			const SoftVertex &vertex = vertices[triangleIndices[i * 3 + k]];
+			corners[k] = &vertex;
+			float w = vertex.position[3];
+			if (!(w > 0.0f))
+			{
+				visible = false;
+				break;
+			}
+			double sx = (vertex.position[0] / w * 0.5 + 0.5) * framebuffer.width;
+			double sy = (vertex.position[1] / w * 0.5 + 0.5) * framebuffer.height;
+			if (std::fabs(sx) > (1 << 20) || std::fabs(sy) > (1 << 20))
+			{
+				visible = false;
+				break;
+			}
+			X[k] = (long long)std::floor(sx * SUBPIXEL_ONE + 0.5);
+			Y[k] = (long long)std::floor(sy * SUBPIXEL_ONE + 0.5);
+		}
+		if (!visible)
+			continue;
+
+		// No face culling, clockwise triangles are flipped so inside is always positive
+		long long area = (X[1] - X[0]) * (Y[2] - Y[0]) - (X[2] - X[0]) * (Y[1] - Y[0]);
+		if (area == 0)
+			continue;
+		if (area < 0)
+		{
+			std::swap(X[1], X[2]);
+			std::swap(Y[1], Y[2]);
+		}
+
+		long long minXs = std::min(X[0], std::min(X[1], X[2]));
+		long long maxXs = std::max(X[0], std::max(X[1], X[2]));
+		long long minYs = std::min(Y[0], std::min(Y[1], Y[2]));
+		long long maxYs = std::max(Y[0], std::max(Y[1], Y[2]));
+
+		// Pixels whose centers lie inside the bounding box, clamped to the framebuffer
+		triangle.minX = std::max(0, floorDiv(minXs - SUBPIXEL_HALF + SUBPIXEL_ONE - 1, SUBPIXEL_ONE));
+		triangle.maxX = std::min((int)framebuffer.width - 1, floorDiv(maxXs - SUBPIXEL_HALF, SUBPIXEL_ONE));
+		triangle.minY = std::max(0, floorDiv(minYs - SUBPIXEL_HALF + SUBPIXEL_ONE - 1, SUBPIXEL_ONE));
+		triangle.maxY = std::min((int)framebuffer.height - 1, floorDiv(maxYs - SUBPIXEL_HALF, SUBPIXEL_ONE));
+		triangle.wide = maxXs - minXs > NARROW_EXTENT || maxYs - minYs > NARROW_EXTENT;
+
+		// Edge k runs from vertex k + 1 to vertex k + 2; E(p) = A * p.x + B * p.y + C is positive inside
+		for (int k = 0; k < 3; k++)
+		{
+			int a = (k + 1) % 3;
+			int b = (k + 2) % 3;
+			long long A = Y[a] - Y[b];
+			long long B = X[b] - X[a];
+			triangle.A[k] = (int)A;
+			triangle.B[k] = (int)B;
+			triangle.C[k] = -(A * X[a] + B * Y[a]);
+			// Top-left rule: pixels exactly on an edge belong to the triangle only for left or top edges
+			bool topLeft = A > 0 || (A == 0 && B < 0);
+			if (!topLeft)
+				triangle.C[k] -= 1;
+		}
+
+		// vColor is per instance, so it is constant over the triangle and the fragment shader runs once
+		float fragColor[4];
+		softFragmentShader(corners[0]->color, fragColor);
+		triangle.color = packColor(fragColor);
+	}
+}
+
+void SoftRasterizer::binTriangles(unsigned int range, unsigned int first, unsigned int last)
+{
+	std::vector<std::vector<unsigned int> > &rangeBins = bins[range];
+	for (unsigned int i = first; i < last; i++)
+	{
+		const Triangle &triangle = triangles[i];
+		if (triangle.minX > triangle.maxX || triangle.minY > triangle.maxY)
+			continue;
+		for (int ty = triangle.minY / (int)TILE_SIZE; ty <= triangle.maxY / (int)TILE_SIZE; ty++)
+			for (int tx = triangle.minX / (int)TILE_SIZE; tx <= triangle.maxX / (int)TILE_SIZE; tx++)
+				rangeBins[ty * tilesX + tx].push_back(i);
+	}
+}
+
+void SoftRasterizer::rasterizeTile(unsigned int tile)
+{
+	int tileMinX = (int)((tile % tilesX) * TILE_SIZE);
+	int tileMinY = (int)((tile / tilesX) * TILE_SIZE);
+	int tileMaxX = std::min(tileMinX + (int)TILE_SIZE, (int)framebuffer.width) - 1;
+	int tileMaxY = std::min(tileMinY + (int)TILE_SIZE, (int)framebuffer.height) - 1;
+
+	// Ranges hold consecutive triangles, so walking them in order keeps submission order
+	for (unsigned int range = 0; range < threadCount; range++)
+	{
+		const std::vector<unsigned int> &bin = bins[range][tile];
+		for (size_t n = 0; n < bin.size(); n++)
+		{
+			const Triangle &triangle = triangles[bin[n]];
+			int minX = std::max(triangle.minX, tileMinX);
+			int maxX = std::min(triangle.maxX, tileMaxX);
+			int minY = std::max(triangle.minY, tileMinY);
+			int maxY = std::min(triangle.maxY, tileMaxY);
+
+			if (triangle.wide)
+			{
+				for (int y = minY; y <= maxY; y++)
+				{
+					unsigned int *row = &framebuffer.pixels[(size_t)y * framebuffer.pitch];
+					long long py = (long long)y * SUBPIXEL_ONE + SUBPIXEL_HALF;
+					for (int x = minX; x <= maxX; x++)
+					{
+						long long px = (long long)x * SUBPIXEL_ONE + SUBPIXEL_HALF;
+						bool inside = true;
+						for (int k = 0; k < 3; k++)
+							inside = inside && (long long)triangle.A[k] * px + (long long)triangle.B[k] * py + triangle.C[k] >= 0;
+						if (inside)
+							row[x] = triangle.color;
+					}
+				}
+				continue;
+			}
+
+			// Spans start on a multiple of 8 pixels; the extra pixels lie outside the bounding box
+			// (or in the row padding) and fail the edge test
+			int spanStart = minX & ~7;
+			int stepX[3];
+			for (int k = 0; k < 3; k++)
+				stepX[k] = triangle.A[k] * SUBPIXEL_ONE;
+
+			for (int y = minY; y <= maxY; y++)
+			{
+				unsigned int *row = &framebuffer.pixels[(size_t)y * framebuffer.pitch];
+				long long py = (long long)y * SUBPIXEL_ONE + SUBPIXEL_HALF;
+				long long px = (long long)spanStart * SUBPIXEL_ONE + SUBPIXEL_HALF;
+				int e[3];
+				for (int k = 0; k < 3; k++)
+					e[k] = (int)(triangle.A[k] * px + triangle.B[k] * py + triangle.C[k]);
+
+#if defined(__AVX2__)
+				__m256i color = _mm256_set1_epi32((int)triangle.color);
+				__m256i edge[3], step[3];
+				for (int k = 0; k < 3; k++)
+				{
+					edge[k] = _mm256_add_epi32(_mm256_set1_epi32(e[k]),
+						_mm256_mullo_epi32(_mm256_set1_epi32(stepX[k]), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7)));
+					step[k] = _mm256_set1_epi32(stepX[k] * 8);
+				}
+				for (int x = spanStart; x <= maxX; x += 8)
+				{
+					// Inside where no edge function is negative
+					__m256i any = _mm256_or_si256(edge[0], _mm256_or_si256(edge[1], edge[2]));
+					__m256i inside = _mm256_cmpgt_epi32(any, _mm256_set1_epi32(-1));
+					if (!_mm256_testz_si256(inside, inside))
+					{
+						__m256i *dst = (__m256i *)&row[x];
+						__m256i old = _mm256_loadu_si256(dst);
+						_mm256_storeu_si256(dst, _mm256_blendv_epi8(old, color, inside));
+					}
+					for (int k = 0; k < 3; k++)
+						edge[k] = _mm256_add_epi32(edge[k], step[k]);
+				}
+#elif defined(SOFT_RASTER_SSE2)
+				__m128i color = _mm_set1_epi32((int)triangle.color);
+				__m128i edge[3], step[3];
+				for (int k = 0; k < 3; k++)
+				{
+					edge[k] = _mm_setr_epi32(e[k], e[k] + stepX[k], e[k] + 2 * stepX[k], e[k] + 3 * stepX[k]);
+					step[k] = _mm_set1_epi32(stepX[k] * 4);
+				}
+				for (int x = spanStart; x <= maxX; x += 4)
+				{
+					__m128i any = _mm_or_si128(edge[0], _mm_or_si128(edge[1], edge[2]));
+					__m128i inside = _mm_cmpgt_epi32(any, _mm_set1_epi32(-1));
+					if (_mm_movemask_epi8(inside))
+					{
+						__m128i *dst = (__m128i *)&row[x];
+						__m128i old = _mm_loadu_si128(dst);
+						_mm_storeu_si128(dst, _mm_or_si128(_mm_and_si128(inside, color), _mm_andnot_si128(inside, old)));
+					}
+					for (int k = 0; k < 3; k++)
+						edge[k] = _mm_add_epi32(edge[k], step[k]);
+				}
+#else
+				for (int x = spanStart; x <= maxX; x++)
+				{
+					if ((e[0] | e[1] | e[2]) >= 0)
+						row[x] = triangle.color;
+					for (int k = 0; k < 3; k++)
+						e[k] += stepX[k];
+				}
+#endif
+			}
+		}
+	}
+}
@@ -0,0 +1,93 @@
+#ifndef SOFT_RASTER_H
+#define SOFT_RASTER_H
+
+#include "instancing.h"
+#include "job_system.h"
+
+#include <vector>
+
+// RGBA8 color buffer, row 0 is the bottom row like glReadPixels returns it
+// ------------------------------------------------------------------------
+struct SoftFramebuffer
+{
+	unsigned int width = 0;
+	unsigned int height = 0;
+	// Rows are padded to a multiple of 8 pixels so SIMD spans never need a scalar tail
+	unsigned int pitch = 0;
+	std::vector<unsigned int> pixels;
+
+	void resize(unsigned int width, unsigned int height);
+	void clear(const float color[4]);
+
+	// Copies the visible pixels into a tightly packed RGBA8 array
+	void copyTo(std::vector<unsigned char> &rgba) const;
+
+	// 64-bit FNV-1a of the visible pixels, stable across SIMD widths and thread counts
+	unsigned long long hash() const;
+};
+
+// Output of the vertex stage, matching gl_Position and vColor of vertexShaderSource
+struct SoftVertex
+{
+	float position[4];
+	float color[4];
+};
+
+// C++ equivalents of vertexShaderSource and fragmentShaderSource
+void softVertexShader(const float aPos[3], const InstanceData &instance, SoftVertex &out);
+void softFragmentShader(const float vColor[4], float fragColor[4]);
+
+// CPU rasterizer for indexed triangle lists
+// Triangles are snapped to 1/16 pixel and rasterized with integer edge functions using the top-left fill rule,
+// 8 pixels at a time with AVX2 or 4 with SSE2. Binning into 64x64 tiles and rasterizing the tiles are both
+// spread over the rasterizer's own JobSystem, whose workers persist across draws; tiles replay triangles
+// in submission order so the image is deterministic
+// -----------------------------------------------------------------------------------------------------------
+class SoftRasterizer
+{
+public:
+	static const unsigned int TILE_SIZE = 64;
+
+	// Starts the worker threads, threads == 0 uses every hardware thread. Draw from the calling thread
+	void init(unsigned int width, unsigned int height, unsigned int threads);
+
+	SoftFramebuffer &getFramebuffer() { return framebuffer; }
+	unsigned int getThreadCount() const { return threadCount; }
+
+	// Name of the edge evaluation path compiled in ("AVX2", "SSE2" or "scalar")
+	static const char *simdPath();
+
+	void clear(const float color[4]);
+
+	// Equivalent of glDrawElementsInstanced(GL_TRIANGLES, ...) with positions as three floats per vertex
+	void drawElementsInstanced(const float *positions, unsigned int vertexCount, const unsigned int *indices,
+		unsigned int indexCount, const InstanceData *instances, unsigned int instanceCount);
+
+private:
+	struct Triangle
+	{
+		int minX, minY, maxX, maxY;
+		int A[3], B[3];
+		long long C[3];
+		unsigned int color;
+		bool wide;
+	};
+
+	void setupTriangles(const SoftVertex *vertices, const unsigned int *indices, unsigned int first, unsigned int count,
+		std::vector<Triangle> &out) const;
+	void binTriangles(unsigned int range, unsigned int first, unsigned int last);
+	void rasterizeTile(unsigned int tile);
+
+	SoftFramebuffer framebuffer;
+	JobSystem jobs;
+	unsigned int threadCount = 1;
+	unsigned int tilesX = 0;
+	unsigned int tilesY = 0;
+
+	std::vector<SoftVertex> transformed;
+	std::vector<Triangle> triangles;
+	// bins[range][tile] lists triangle indices, each of the threadCount ranges bins contiguous triangles
+	std::vector<std::vector<std::vector<unsigned int> > > bins;
+};
+
+#endif
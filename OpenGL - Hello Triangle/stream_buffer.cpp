@@ -0,0 +1,113 @@
+#include <glad/glad.h>
+
+#include "gl_state.h"
+#include "stream_buffer.h"
+
+void StreamBuffer::init(unsigned int bufferTarget, size_t bytesPerRegion)
+{
+	target = bufferTarget;
+	regionSize = bytesPerRegion;
+	region = 0;
+	regionOffset = 0;
+	size_t totalSize = regionSize * REGION_COUNT;
+
+	glGenBuffers(1, &buffer);
+	glState.bindBuffer(target, buffer);
+
+	persistent = GLAD_GL_VERSION_4_4 || GLAD_GL_ARB_buffer_storage;
+	if (persistent)
+	{
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glBufferStorage(target, totalSize, NULL, flags);
+		mapping = (unsigned char *)glMapBufferRange(target, 0, totalSize, flags);
+		persistent = mapping != NULL;
+	}
+	if (!persistent)
+	{
+		glBufferData(target, totalSize, NULL, GL_STREAM_DRAW);
+		staging.resize(totalSize);
+		mapping = staging.data();
+	}
+}
+
+void StreamBuffer::destroy()
+{
+	for (unsigned int i = 0; i < REGION_COUNT; i++)
+	{
+		if (fences[i])
+			glDeleteSync((GLsync)fences[i]);
+		fences[i] = NULL;
+	}
+	if (persistent && buffer)
+	{
+		glState.bindBuffer(target, buffer);
+		glUnmapBuffer(target);
+	}
+	glState.deleteBuffers(1, &buffer);
+	buffer = 0;
+	mapping = NULL;
+	staging.clear();
+}
+
+void *StreamBuffer::allocate(size_t size, size_t alignment, size_t &offset)
+{
+	if (size > regionSize)
+		return NULL;
+
+	size_t regionStart = region * regionSize;
+	size_t aligned = (regionStart + regionOffset + alignment - 1) / alignment * alignment - regionStart;
+	if (aligned + size > regionSize)
+	{
+		advanceRegion();
+		regionStart = region * regionSize;
+		aligned = (regionStart + alignment - 1) / alignment * alignment - regionStart;
+		if (aligned + size > regionSize)
+			return NULL;
+	}
+
+	offset = regionStart + aligned;
+	regionOffset = aligned + size;
+	return mapping + offset;
+}
+
+void StreamBuffer::commit(size_t offset, size_t size)
+{
+	// Coherent persistent mappings need nothing, writes are visible to commands issued afterwards
+	if (persistent || size == 0)
+		return;
+	glState.bindBuffer(target, buffer);
+	glBufferSubData(target, offset, size, mapping + offset);
+}
+
+void StreamBuffer::endFrame()
+{
+	if (regionOffset > 0)
+		advanceRegion();
+}
+
+void StreamBuffer::advanceRegion()
+{
+	// Everything issued so far may read the region we are leaving
+	if (fences[region])
+		glDeleteSync((GLsync)fences[region]);
+	fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+	region = (region + 1) % REGION_COUNT;
+	regionOffset = 0;
+
+	GLsync fence = (GLsync)fences[region];
+	if (!fence)
+		return;
+
+	// Poll first so only real stalls are counted, then flush and wait
+	GLenum result = glClientWaitSync(fence, 0, 0);
+	if (result == GL_TIMEOUT_EXPIRED)
+	{
+		waits++;
+		do
+			result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+		while (result == GL_TIMEOUT_EXPIRED);
+	}
+	glDeleteSync(fence);
+	fences[region] = NULL;
+}
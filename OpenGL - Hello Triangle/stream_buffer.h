@@ -0,0 +1,56 @@
+#ifndef STREAM_BUFFER_H
+#define STREAM_BUFFER_H
+
+#include <cstddef>
+#include <vector>
+
+// Ring buffer for geometry written by the CPU every frame
+// The buffer is split into REGION_COUNT regions; the CPU writes into one while the GPU reads the others.
+// Each region is fenced (glFenceSync) when the CPU moves on and waited on (glClientWaitSync) before it is
+// written again, so no implicit synchronization ever happens inside the driver
+// With GL 4.4 / ARB_buffer_storage the whole buffer is mapped once, persistently and coherently, and
+// writes land in GPU-visible memory directly; otherwise writes go to a CPU copy uploaded on commit()
+// --------------------------------------------------------------------------------------------------------
+class StreamBuffer
+{
+public:
+	static const unsigned int REGION_COUNT = 3;
+
+	// Creates the buffer object and binds it to target, requires glad to be loaded
+	void init(unsigned int target, size_t regionSize);
+	void destroy();
+
+	unsigned int getBuffer() const { return buffer; }
+	bool isPersistent() const { return persistent; }
+
+	// Reserves size bytes, aligned to alignment (any positive value, e.g. a vertex stride) from the start
+	// of the buffer. Returns a write pointer and the offset of the reservation in the buffer object,
+	// or NULL if size exceeds a region. Moving to the next region waits for the GPU to release it
+	void *allocate(size_t size, size_t alignment, size_t &offset);
+
+	// Makes bytes written to [offset, offset + size) visible to subsequent draws
+	void commit(size_t offset, size_t size);
+
+	// Fences the current region and moves on, call once the frame's draws have been issued
+	void endFrame();
+
+	// Number of times allocate or endFrame had to block on a fence
+	unsigned int getWaits() const { return waits; }
+
+private:
+	void advanceRegion();
+
+	unsigned int target = 0;
+	unsigned int buffer = 0;
+	bool persistent = false;
+	unsigned char *mapping = NULL;
+	std::vector<unsigned char> staging;
+
+	size_t regionSize = 0;
+	unsigned int region = 0;
+	size_t regionOffset = 0;
+	void *fences[REGION_COUNT] = {};
+	unsigned int waits = 0;
+};
+
+#endif
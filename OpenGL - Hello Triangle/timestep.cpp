@@ -0,0 +1,89 @@
+#include <glad/glad.h>
+
+#include "timestep.h"
+
+// FixedTimestep
+// -------------
+void FixedTimestep::init(unsigned int hz, unsigned int maxSteps)
+{
+	stepNanoseconds = NANOSECONDS_PER_SECOND / (hz ? hz : 60);
+	maxStepsPerFrame = maxSteps ? maxSteps : 1;
+	accumulated = 0;
+	steps = 0;
+	dropped = 0;
+}
+
+unsigned int FixedTimestep::advance(long long elapsedNanoseconds)
+{
+	if (elapsedNanoseconds > 0)
+		accumulated += elapsedNanoseconds;
+
+	unsigned int due = (unsigned int)(accumulated / stepNanoseconds);
+	if (due > maxStepsPerFrame)
+	{
+		dropped += due - maxStepsPerFrame;
+		accumulated -= (long long)(due - maxStepsPerFrame) * stepNanoseconds;
+		due = maxStepsPerFrame;
+	}
+	accumulated -= (long long)due * stepNanoseconds;
+	steps += due;
+	return due;
+}
+
+// InputLatency
+// ------------
+void InputLatency::onInput()
+{
+	// Only the oldest unconsumed event matters, it is the one that waited longest
+	if (!hasInput)
+	{
+		hasInput = true;
+		pendingInput = Clock::now();
+	}
+}
+
+void InputLatency::consumeInput()
+{
+	if (!hasInput)
+		return;
+	if (!hasConsumed)
+	{
+		hasConsumed = true;
+		consumedInput = pendingInput;
+	}
+	hasInput = false;
+}
+
+void InputLatency::frameSubmitted()
+{
+	if (!hasConsumed)
+		return;
+	Frame frame;
+	frame.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	frame.input = consumedInput;
+	inFlight.push_back(frame);
+	hasConsumed = false;
+}
+
+void InputLatency::poll(bool wait)
+{
+	while (!inFlight.empty())
+	{
+		Frame &frame = inFlight.front();
+		GLenum result = glClientWaitSync((GLsync)frame.fence, wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, wait ? 1000000000 : 0);
+		if (result == GL_TIMEOUT_EXPIRED && wait)
+			continue;
+		if (result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED)
+			return;
+		samples.push_back(std::chrono::duration<double, std::milli>(Clock::now() - frame.input).count());
+		glDeleteSync((GLsync)frame.fence);
+		inFlight.pop_front();
+	}
+}
+
+void InputLatency::destroy()
+{
+	for (size_t i = 0; i < inFlight.size(); i++)
+		glDeleteSync((GLsync)inFlight[i].fence);
+	inFlight.clear();
+}
@@ -0,0 +1,83 @@
+#ifndef TIMESTEP_H
+#define TIMESTEP_H
+
+#include <chrono>
+#include <deque>
+#include <vector>
+
+// Fixed-rate simulation clock
+// Real (or virtual) frame time is accumulated and spent in whole steps of 1/hz, so simulation runs
+// at the same rate whatever the presentation rate is. Rendering uses the state between the last
+// two steps at getAlpha(), which hides the step rate when it is below the frame rate
+// Time is kept in integer nanoseconds so a frame time equal to the step always gives exactly one step
+// --------------------------------------------------------------------------------------------------
+class FixedTimestep
+{
+public:
+	static const long long NANOSECONDS_PER_SECOND = 1000000000LL;
+
+	// A frame longer than maxSteps steps drops the excess instead of trying to catch up (spiral of death)
+	void init(unsigned int hz, unsigned int maxSteps = 8);
+
+	// Adds elapsed time and returns the number of steps to run now
+	unsigned int advance(long long elapsedNanoseconds);
+
+	double getStepSeconds() const { return (double)stepNanoseconds / NANOSECONDS_PER_SECOND; }
+	// Simulated time after the last step, in seconds
+	double getTime() const { return (double)steps * stepNanoseconds / NANOSECONDS_PER_SECOND; }
+	// Fraction of a step accumulated past the last one, in [0, 1)
+	double getAlpha() const { return (double)accumulated / stepNanoseconds; }
+	// Time to render: between the previous step (alpha 0) and the last one (alpha 1)
+	double getInterpolatedTime() const { return getTime() - getStepSeconds() * (1.0 - getAlpha()); }
+
+	unsigned long long getSteps() const { return steps; }
+	unsigned long long getDroppedSteps() const { return dropped; }
+
+private:
+	long long stepNanoseconds = NANOSECONDS_PER_SECOND / 60;
+	long long accumulated = 0;
+	unsigned int maxStepsPerFrame = 8;
+	unsigned long long steps = 0;
+	unsigned long long dropped = 0;
+};
+
+// Measures input-to-photon latency
+// Input events are timestamped as they arrive; the first simulation step after them consumes them,
+// and the frame rendered after that step carries the oldest consumed timestamp. A fence is inserted
+// after that frame's swap, and the latency sample is taken when the fence is seen signaled, i.e. once
+// the GPU has finished the frame that shows the input. Scan-out is not included
+// ---------------------------------------------------------------------------------------------------
+class InputLatency
+{
+public:
+	typedef std::chrono::steady_clock Clock;
+
+	// Call from input callbacks
+	void onInput();
+	// Call at every simulation step, input so far is applied by it
+	void consumeInput();
+	// Call right after the swap, requires glad to be loaded
+	void frameSubmitted();
+	// Checks in-flight frames, taking samples for finished ones; wait blocks until all are finished
+	void poll(bool wait);
+	void destroy();
+
+	// Milliseconds from input to GPU completion, one per frame that showed new input
+	const std::vector<double> &getSamples() const { return samples; }
+
+private:
+	struct Frame
+	{
+		void *fence;
+		Clock::time_point input;
+	};
+
+	bool hasInput = false;
+	Clock::time_point pendingInput;
+	bool hasConsumed = false;
+	Clock::time_point consumedInput;
+	std::deque<Frame> inFlight;
+	std::vector<double> samples;
+};
+
+#endif
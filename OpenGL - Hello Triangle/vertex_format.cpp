@@ -0,0 +1,173 @@
+#include <glad/glad.h>
+
+#include "vertex_format.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+unsigned int getVertexStride(MeshVertexFormat format)
+{
+	switch (format)
+	{
+	case MESH_VERTEX_POSITION_U16: return 4 * sizeof(unsigned short);
+	case MESH_VERTEX_POSITION_I10: return sizeof(unsigned int);
+	default: return 3 * sizeof(float);
+	}
+}
+
+const char *getVertexFormatName(MeshVertexFormat format)
+{
+	switch (format)
+	{
+	case MESH_VERTEX_POSITION_U16: return "u16";
+	case MESH_VERTEX_POSITION_I10: return "i10";
+	default: return "f32";
+	}
+}
+
+bool parseVertexFormat(const char *name, MeshVertexFormat &format)
+{
+	const MeshVertexFormat formats[] = { MESH_VERTEX_POSITION_F32, MESH_VERTEX_POSITION_U16, MESH_VERTEX_POSITION_I10 };
+	for (size_t i = 0; i < sizeof(formats) / sizeof(formats[0]); i++)
+		if (std::strcmp(name, getVertexFormatName(formats[i])) == 0)
+		{
+			format = formats[i];
+			return true;
+		}
+	return false;
+}
+
+void computeBounds(const float *positions, unsigned int vertexCount, float boundsMin[3], float boundsMax[3])
+{
+	for (int axis = 0; axis < 3; axis++)
+	{
+		boundsMin[axis] = vertexCount ? positions[axis] : 0.0f;
+		boundsMax[axis] = vertexCount ? positions[axis] : 0.0f;
+	}
+	for (unsigned int i = 1; i < vertexCount; i++)
+		for (int axis = 0; axis < 3; axis++)
+		{
+			boundsMin[axis] = std::min(boundsMin[axis], positions[i * 3 + axis]);
+			boundsMax[axis] = std::max(boundsMax[axis], positions[i * 3 + axis]);
+		}
+}
+
+// Largest integer of each quantized format, u16 spans [0, 65535] and i10 [-511, 511]
+static const float U16_MAX = 65535.0f;
+static const float I10_MAX = 511.0f;
+
+PositionQuantization computeQuantization(MeshVertexFormat format, const float boundsMin[3], const float boundsMax[3])
+{
+	PositionQuantization quantization;
+	if (format == MESH_VERTEX_POSITION_F32)
+		return quantization;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		float extent = boundsMax[axis] - boundsMin[axis];
+		if (format == MESH_VERTEX_POSITION_U16)
+		{
+			quantization.scale[axis] = extent / U16_MAX;
+			quantization.offset[axis] = boundsMin[axis];
+		}
+		else
+		{
+			quantization.scale[axis] = extent * 0.5f / I10_MAX;
+			quantization.offset[axis] = (boundsMin[axis] + boundsMax[axis]) * 0.5f;
+		}
+	}
+	return quantization;
+}
+
+// Nearest integer step for value, clamped to [low, high]; a flat axis encodes as 0
+static int quantize(float value, float scale, float offset, float low, float high)
+{
+	if (scale <= 0.0f)
+		return 0;
+	return (int)std::floor(std::min(std::max((value - offset) / scale, low), high) + 0.5f);
+}
+
+void quantizePositions(MeshVertexFormat format, const PositionQuantization &quantization,
+	const float *positions, unsigned int vertexCount, std::vector<unsigned char> &out)
+{
+	unsigned int stride = getVertexStride(format);
+	out.assign((size_t)vertexCount * stride, 0);
+	for (unsigned int i = 0; i < vertexCount; i++)
+	{
+		const float *position = positions + i * 3;
+		unsigned char *vertex = &out[(size_t)i * stride];
+		if (format == MESH_VERTEX_POSITION_F32)
+			std::memcpy(vertex, position, stride);
+		else if (format == MESH_VERTEX_POSITION_U16)
+		{
+			unsigned short packed[4] = { 0, 0, 0, 0 };
+			for (int axis = 0; axis < 3; axis++)
+				packed[axis] = (unsigned short)quantize(position[axis], quantization.scale[axis], quantization.offset[axis], 0.0f, U16_MAX);
+			std::memcpy(vertex, packed, sizeof(packed));
+		}
+		else
+		{
+			// x in bits 0-9, y in 10-19, z in 20-29, w (unused) in 30-31, two's complement
+			unsigned int packed = 0;
+			for (int axis = 0; axis < 3; axis++)
+			{
+				int value = quantize(position[axis], quantization.scale[axis], quantization.offset[axis], -I10_MAX, I10_MAX);
+				packed |= ((unsigned int)value & 0x3FF) << (axis * 10);
+			}
+			std::memcpy(vertex, &packed, sizeof(packed));
+		}
+	}
+}
+
+void setupPositionAttribute(MeshVertexFormat format)
+{
+	GLsizei stride = (GLsizei)getVertexStride(format);
+	if (format == MESH_VERTEX_POSITION_U16)
+		glVertexAttribPointer(POSITION_LOCATION, 3, GL_UNSIGNED_SHORT, GL_FALSE, stride, (void*)0);
+	else if (format == MESH_VERTEX_POSITION_I10)
+		glVertexAttribPointer(POSITION_LOCATION, 4, GL_INT_2_10_10_10_REV, GL_FALSE, stride, (void*)0);
+	else
+		glVertexAttribPointer(POSITION_LOCATION, 3, GL_FLOAT, GL_FALSE, stride, (void*)0);
+	glEnableVertexAttribArray(POSITION_LOCATION);
+}
+
+void setPositionDequantization(const PositionQuantization &quantization)
+{
+	glVertexAttrib3fv(POSITION_SCALE_LOCATION, quantization.scale);
+	glVertexAttrib3fv(POSITION_OFFSET_LOCATION, quantization.offset);
+}
+
+unsigned int chooseIndexSize(unsigned int vertexCount)
+{
+	if (vertexCount <= 0x100)
+		return sizeof(unsigned char);
+	if (vertexCount <= 0x10000)
+		return sizeof(unsigned short);
+	return sizeof(unsigned int);
+}
+
+unsigned int getIndexType(unsigned int indexSize)
+{
+	switch (indexSize)
+	{
+	case sizeof(unsigned char): return GL_UNSIGNED_BYTE;
+	case sizeof(unsigned short): return GL_UNSIGNED_SHORT;
+	default: return GL_UNSIGNED_INT;
+	}
+}
+
+void packIndices(const unsigned int *indices, size_t indexCount, unsigned int indexSize, std::vector<unsigned char> &out)
+{
+	out.resize(indexCount * indexSize);
+	if (indexSize == sizeof(unsigned int))
+		std::memcpy(out.data(), indices, out.size());
+	else if (indexSize == sizeof(unsigned short))
+		for (size_t i = 0; i < indexCount; i++)
+		{
+			unsigned short index = (unsigned short)indices[i];
+			std::memcpy(&out[i * sizeof(index)], &index, sizeof(index));
+		}
+	else
+		for (size_t i = 0; i < indexCount; i++)
+			out[i] = (unsigned char)indices[i];
+}
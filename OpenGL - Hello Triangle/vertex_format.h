@@ -0,0 +1,70 @@
+#ifndef VERTEX_FORMAT_H
+#define VERTEX_FORMAT_H
+
+#include <cstddef>
+#include <vector>
+
+// Vertex position formats
+// Quantized positions are stored as integers relative to the mesh bounds and turned back into
+// object space by the vertex shader: position = aPos * aPositionScale + aPositionOffset. The
+// attributes are read unnormalized, so the integer to float conversion is exact on every GL version
+// (normalized GL_INT_2_10_10_10_REV changed its rounding rule in GL 4.2)
+// -------------------------------------------------------------------------------------------------
+enum MeshVertexFormat
+{
+	// 3 floats, 12 bytes
+	MESH_VERTEX_POSITION_F32 = 0,
+	// 3 unsigned 16-bit integers over the bounds plus padding, 8 bytes
+	MESH_VERTEX_POSITION_U16 = 1,
+	// GL_INT_2_10_10_10_REV, 3 signed 10-bit integers around the bounds' center, 4 bytes
+	MESH_VERTEX_POSITION_I10 = 2
+};
+
+const unsigned int POSITION_LOCATION = 0;
+// Generic attributes, set once per mesh with setPositionDequantization()
+const unsigned int POSITION_SCALE_LOCATION = 3;
+const unsigned int POSITION_OFFSET_LOCATION = 4;
+
+struct PositionQuantization
+{
+	float scale[3] = { 1.0f, 1.0f, 1.0f };
+	float offset[3] = { 0.0f, 0.0f, 0.0f };
+};
+
+unsigned int getVertexStride(MeshVertexFormat format);
+const char *getVertexFormatName(MeshVertexFormat format);
+// Accepts the names getVertexFormatName() returns: f32, u16, i10
+bool parseVertexFormat(const char *name, MeshVertexFormat &format);
+
+// Axis-aligned bounds of positions (3 floats per vertex), zero when there are none
+void computeBounds(const float *positions, unsigned int vertexCount, float boundsMin[3], float boundsMax[3]);
+
+// Scale and offset that map the format's integer range onto the bounds, identity for f32
+PositionQuantization computeQuantization(MeshVertexFormat format, const float boundsMin[3], const float boundsMax[3]);
+
+// Encodes positions in the format with the given quantization, getVertexStride() bytes per vertex
+void quantizePositions(MeshVertexFormat format, const PositionQuantization &quantization,
+	const float *positions, unsigned int vertexCount, std::vector<unsigned char> &out);
+
+// Points POSITION_LOCATION of the bound vertex array at the bound GL_ARRAY_BUFFER in the format
+void setupPositionAttribute(MeshVertexFormat format);
+
+// Sets the generic scale and offset attributes the vertex shader dequantizes with
+void setPositionDequantization(const PositionQuantization &quantization);
+
+// Index formats
+// Index buffers use the narrowest type that addresses every vertex of the mesh: 8-bit up to 256
+// vertices, 16-bit up to 65536, 32-bit beyond. Primitive restart isn't used, so the largest value
+// of each type is a valid index
+// -----------------------------------------------------------------------------------------------
+
+// Index size in bytes, 1, 2 or 4, for a mesh of vertexCount vertices
+unsigned int chooseIndexSize(unsigned int vertexCount);
+
+// GL_UNSIGNED_BYTE, GL_UNSIGNED_SHORT or GL_UNSIGNED_INT for an index size in bytes
+unsigned int getIndexType(unsigned int indexSize);
+
+// Narrows 32-bit indices to indexSize bytes each, the indices must fit
+void packIndices(const unsigned int *indices, size_t indexCount, unsigned int indexSize, std::vector<unsigned char> &out);
+
+#endif